@@ -22,4 +22,25 @@ namespace up
     static const std::string GREEN = "\e[32m";
     static const std::string YELLOW = "\e[33m";
     static const std::string BLUE = "\e[34m";
+
+    // Returns s without color sequences
+    inline std::string removeColors(const std::string &s)
+    {
+        std::string result;
+
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            // Skip \e[...m
+            if (s[i] == '\e')
+            {
+                while (i < s.size() && s[i] != 'm')
+                    ++i;
+                continue;
+            }
+
+            result += s[i];
+        }
+
+        return result;
+    }
 } // namespace up
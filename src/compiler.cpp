@@ -1,43 +1,90 @@
 #include "compiler.h"
 
 #include <sstream>
+#include <regex>
 #include <algorithm>
+#include <functional>
 
 #include "colors.h"
 #include "types.h"
+#include "global.h"
+#include "upm.h"
+#include "interpreter.h"
 
 using namespace std;
 
 namespace up
 {
     Compiler::Compiler()
-        : scanner(*this), parser(scanner, *this)
+        : includeDir(up::includeDir), scanner(*this), parser(scanner, *this)
     {}
 
+    ModuleUnit::~ModuleUnit()
+    {
+        for (auto f : functions)
+            delete f;
+
+        for (auto c : constants)
+            delete c;
+    }
+
     Compiler::~Compiler()
     {
         clearFunctions();
+        clearModuleCache();
     }
 
     int Compiler::parse(const string &FILE_PATH, ostream &programOut)
     {
+        int ret = compile(FILE_PATH);
+
+        if (ret == 0)
+            programOut << program;
+
+        return ret;
+    }
+
+    int Compiler::compile(const string &FILE_PATH)
+    {
+        // Init variables
+        program = "";
+        gccFlags = "";
+        generationError = false;
+        diagnostics.clear();
+
         // Invalid file name
         if (FILE_PATH.size() < 4 || FILE_PATH.substr(FILE_PATH.size() - 3) != ".up")
         {
-            cerr << "The name of the file '" << FILE_PATH << "' is invalid\n";
+            generateError("The name of the file '" + AS_BLUE(FILE_PATH) + "' is invalid",
+                ErrorInfo(Module(Id(FILE_PATH), false), 0, 0), "Input");
 
             return -1;
         }
 
-        // Init variables
-        program = "";
-        generationError = false;
+        resetTypes();
         parsedModules.clear();
         toParseModules = queue<pair<Module, ErrorInfo>>();
         includes.clear();
         scopes.clear();
+        currentFunction = nullptr;
+        processedBlocks.clear();
+        constantIndices.clear();
+        loopRanges.clear();
+        sharedScopes.clear();
+        futures.clear();
+        checkedAccesses.clear();
+        usageScopes.clear();
+        processedUsages.clear();
+        unassignedOperations.clear();
         mainFile = FILE_PATH;
         globalCCode = "";
+        precompiledCode = "";
+        generics.clear();
+        pendingInstances = {};
+        instances.clear();
+        currentInstance = "";
+        instanceCode.clear();
+        instanceDeps.clear();
 
         clearFunctions();
         functions.push_back(UpFunction::createMain());
@@ -51,6 +98,7 @@ namespace up
             Module(mainFile.substr(lastSlash + 1, mainFile.size() - lastSlash - 4), true, mainFile.substr(0, lastSlash));
 
         import(mainModule, ErrorInfo::empty());
+        mainPath = resolvePath(toParseModules.front().first);
 
         // Scan all modules
         int ret = 0;
@@ -64,50 +112,277 @@ namespace up
             modImportInfo = last;
             toParseModules.pop();
 
-            ret = scan(mod);
+            ret = load(mod);
         }
 
         if (ret != 0)
         {
             // Import errors
             // TODO : ErrorInfo::isEmpty
-            if (mod.path() != mainFile)
+            if (resolvePath(mod) != mainPath)
                 generateError("File '" + AS_BLUE(mod.path()) + "' can't be imported\n", modImportInfo);
 
+            commitUnits(false);
+
             return ret;
         }
 
-        // Generate
-        generate();
+        // Monomorphize generic types
+        if (instantiateGenerics() != 0)
+        {
+            commitUnits(false);
+
+            return 1;
+        }
+
+        // Add a return statement to main (its variables are destroyed before)
+        auto err = ErrorInfo::empty();
+        ((UpFunction*) main())->body->
+            pushStatement(new Return(err, new Literal(err, "0", Id("int"))));
+
+        // Copies of functions are created for this compilation
+        // (see processFunctions)
+        for (auto f : functions)
+            if (auto upFunc = dynamic_cast<UpFunction*>(f))
+                upFunc->specializations.clear();
+
+        // Check and generate
+        processLayouts();
+        processConstants();
+        processFunctions();
+        reportBounds();
+
+        if (!generationError)
+            releaseBorrowed();
+
+        if (!generationError)
+            restrictObjects();
+
+        if (!generationError)
+            optimizeCalls();
+
+        if (!generationError)
+            evaluateConstants();
+
+        if (!generationError)
+            for (auto i : constantIndices)
+                i->checkBounds(this);
+
+        if (!generationError && !checkOnly)
+            generate();
+
+        commitUnits(!generationError);
 
         if (generationError)
+        {
+            program = "";
             return 1;
+        }
+
+        return ret;
+    }
+
+    vector<string> Compiler::cachedModules() const
+    {
+        vector<string> paths;
+        for (auto &[path, _] : moduleCache)
+            paths.push_back(path);
+
+        return paths;
+    }
+
+    void Compiler::invalidateModule(const string &PATH)
+    {
+        // Functions of the last compilation may belong to cached modules
+        clearFunctions();
+
+        set<string> invalid = { VirtualFS::normalize(PATH) };
+
+        // Find modules which depend on invalid modules
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            for (auto [path, unit] : moduleCache)
+            {
+                if (invalid.find(path) != invalid.end())
+                    continue;
+
+                for (auto [imp, _] : unit->imports)
+                {
+                    // The file of an up module has the extension
+                    imp.id.name() += ".up";
+
+                    if (invalid.find(resolvePath(imp)) != invalid.end())
+                    {
+                        invalid.insert(path);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (auto path : invalid)
+        {
+            auto i = moduleCache.find(path);
+            if (i == moduleCache.end())
+                continue;
+
+            for (auto f : i->second->functions)
+                cachedFunctions.erase(f);
 
-        programOut << program;
+            for (auto c : i->second->constants)
+                cachedConstants.erase(c);
+
+            delete i->second;
+            moduleCache.erase(i);
+        }
+    }
+
+    void Compiler::clearModuleCache()
+    {
+        clearFunctions();
+
+        for (auto [_, unit] : moduleCache)
+            delete unit;
+
+        moduleCache.clear();
+        cachedFunctions.clear();
+        cachedConstants.clear();
+    }
+
+    int Compiler::emitModule(const string &SOURCE, const string &OUT)
+    {
+        if (SOURCE.size() < 4 || SOURCE.substr(SOURCE.size() - 3) != ".up")
+        {
+            generateError("The name of the module '" + AS_BLUE(SOURCE) + "' is invalid",
+                ErrorInfo(Module(Id(SOURCE), false), 0, 0), "Input");
+
+            return -1;
+        }
+
+        size_t slash = SOURCE.find_last_of('/');
+        const string FOLDER = slash == string::npos ? "." : SOURCE.substr(0, slash);
+        const string NAME = SOURCE.substr(slash == string::npos ? 0 : slash + 1,
+            SOURCE.size() - (slash == string::npos ? 0 : slash + 1) - 3);
+
+        // The module is imported by a temporary entry
+        const string ENTRY = FOLDER + "/__upm__.up";
+        fs.addFile(ENTRY, "use " + NAME + "\n");
+
+        const bool CACHE = cacheModules;
+        const bool UPM = useUpm;
+        const bool LAZY = lazyImports;
+        cacheModules = true;
+        useUpm = false;
+        lazyImports = false;
+
+        int ret = compile(ENTRY);
+
+        fs.removeFile(ENTRY);
+        cacheModules = CACHE;
+        useUpm = UPM;
+        lazyImports = LAZY;
+
+        if (ret == 0)
+        {
+            auto i = moduleCache.find(resolvePath(Module(Id(NAME + ".up"), true, FOLDER)));
+
+            if (i == moduleCache.end())
+            {
+                generateError("The module '" + AS_BLUE(SOURCE) +
+                    "' can't be precompiled because it contains global statements",
+                    ErrorInfo(Module(Id(SOURCE), false), 0, 0), "Input");
+                ret = 1;
+            }
+            else
+            {
+                ModuleUnit *unit = i->second;
+
+                unit->operators.clear();
+                for (auto &type : unit->types)
+                    for (auto op : operatorsOf(type.id))
+                        unit->operators.push_back({ type.id, op });
+
+                if (!writeUpm(OUT, *unit))
+                {
+                    generateError("Can't write the file '" + AS_BLUE(OUT) + "'",
+                        ErrorInfo(Module(Id(SOURCE), false), 0, 0), "Input");
+                    ret = 1;
+                }
+            }
+        }
+
+        if (!cacheModules)
+            clearModuleCache();
 
         return ret;
     }
 
+    string Compiler::resolvePath(const Module &MOD) const
+    {
+        // Relative module
+        if (fs.exists(MOD.path()))
+            return VirtualFS::normalize(MOD.path());
+
+        // Include module
+        return VirtualFS::normalize(includeDir + MOD.id.toPath());
+    }
+
     void Compiler::generateError(const string &MSG, const ErrorInfo &INFO, const string &REASON)
     {
         generationError = true;
 
-        cerr << "File " << INFO.toString() <<
-            " - " << AS_RED_S(REASON + " Error") <<
-            " :\n" << MSG << '\n';
+        diagnostics.push_back(Diagnostic(REASON, removeColors(MSG), INFO));
+
+        if (errorStream)
+            *errorStream << "File " << INFO.toString() <<
+                " - " << AS_RED_S(REASON + " Error") <<
+                " :\n" << MSG << '\n';
     }
 
     void Compiler::pushGlobalStatement(Statement *s)
     {
         // This is a C section
         if (auto cSection = dynamic_cast<CStatement*>(s))
+        {
             addGlobalCCode(cSection->toString());
+            delete s;
+        }
         else
+        {
+            // The statement belongs to the main function of this compilation
+            if (currentUnit)
+                currentUnit->reusable = false;
+
             ((UpFunction*) main())->body->pushStatement(s);
+        }
+    }
+
+    void Compiler::addGlobalCCode(const string &CODE)
+    {
+        const string SECTION = "\n" + CODE + "\n";
+
+        // Emitted with the instances it depends on
+        if (!currentInstance.empty())
+        {
+            instanceCode[currentInstance] += SECTION;
+            return;
+        }
+
+        globalCCode += SECTION;
+
+        if (currentUnit)
+            currentUnit->cCode += SECTION;
     }
 
     void Compiler::import(Module mod, const ErrorInfo &INFO)
     {
+        if (currentUnit)
+            currentUnit->imports.push_back({ mod, INFO });
+
         // Module already imported
         if (parsedModules.find(mod) != parsedModules.end())
             return;
@@ -138,11 +413,79 @@ namespace up
     
     void Compiler::newType(TypeDecl &type)
     {
+        if (currentUnit)
+            currentUnit->types.push_back(type);
+
+        const size_t LAYOUTS = layouts().size();
+
         type.process(this);
+
+        // Error or no generated code
+        if (layouts().size() == LAYOUTS)
+            return;
+
+        set<string> names;
+        for (auto &f : type.fields)
+        {
+            if (!f.id.isSimple())
+                generateError("The field '" + AS_BLUE(f.id.toUp()) + "' of the type '" +
+                    AS_BLUE(type.id.toUp()) + "' must have a simple id (no prefix)", type.info);
+            // The object is the argument me of the methods
+            else if (f.id == "me")
+                generateError("The field '" + AS_BLUE("me") + "' of the type '" +
+                    AS_BLUE(type.id.toUp()) + "' is reserved", type.info);
+            else if (!names.insert(f.id.name()).second)
+                generateError("The field '" + AS_BLUE(f.id.toUp()) + "' of the type '" +
+                    AS_BLUE(type.id.toUp()) + "' already exists", type.info);
+        }
+
+        // Constructors and destructors (see processLayouts)
+        // For example :
+        // cdef Particle Particle.new(num x, num y)
+        // cdef Particles Particles.new(int count)
+        auto args = [&type]()
+        {
+            vector<Argument*> args;
+
+            if (type.soaOf.ids.empty())
+                for (auto &f : type.fields)
+                    args.push_back(new Argument(type.info, f.type, f.id));
+            else
+                args.push_back(new Argument(type.info, Id("int"), Id("count")));
+
+            return args;
+        };
+
+        const string NAME = type.id.name();
+        addFunction(Function::createCDef(type.info, type.id, Id({ NAME, "new" }), args()));
+        addFunction(Function::createCDef(type.info, Id("nil"), Id({ NAME, "del" }), {}));
+        addFunction(Function::createCDef(type.info, Id("nil"), Id({ NAME, "init" }), args()));
+        addFunction(Function::createCDef(type.info, Id("nil"), Id({ NAME, "fini" }), {}));
+
+        // Number of elements of the collection
+        if (!type.soaOf.ids.empty())
+        {
+            auto size = Function::createCDef(type.info, Id("int"), Id({ NAME, "size" }), {});
+            size->modifiers.purity = Purity::Pure;
+            addFunction(size);
+        }
     }
     
     void Compiler::addFunction(Function *f)
     {
+        // This is the lazy function parsed with its body
+        if (lazyTarget)
+        {
+            auto parsed = (UpFunction*) f;
+
+            delete lazyTarget->body;
+            lazyTarget->body = parsed->body;
+            parsed->body = nullptr;
+            delete parsed;
+
+            return;
+        }
+
         // Find same function
         auto i = std::find_if(functions.cbegin(), functions.cend(), [f](const Function* a) -> bool { return *a == *f; });
 
@@ -154,128 +497,1129 @@ namespace up
             return;
         }
 
+        if (currentUnit)
+            currentUnit->functions.push_back(f);
+
         functions.push_back(f);
     }
 
-    Function *Compiler::getFunction(const Id &ID)
+    TypeName Compiler::genericType(const Id &ID, const vector<Expression*> &ARGS, const ErrorInfo &INFO)
     {
-        for (auto f : functions)
-            if (f->id == ID)
-                return f;
+        TypeName t;
+        t.id = ID;
 
-        // Not found
-        return nullptr;
+        // Table
+        auto literal = ARGS.size() == 1 ? dynamic_cast<Literal*>(ARGS[0]) : nullptr;
+        if (literal && literal->type == "int")
+        {
+            t.count = stoi(literal->data);
+
+            if (t.count <= 0)
+                generateError("The size of a table must be positive", INFO);
+
+            return t;
+        }
+
+        if (isTableType(ID))
+        {
+            t.count = ARGS.size() == 1 ? tableSize(ID, ARGS[0], INFO) : 1;
+
+            if (ARGS.size() != 1)
+                generateError("A table has only one size (" + AS_BLUE(ID.toUp() + "[16]") + ")", INFO);
+
+            return t;
+        }
+
+        vector<Id> args;
+        for (auto a : ARGS)
+        {
+            Id arg = a->typeName(this);
+
+            if (arg.ids.empty())
+            {
+                generateError("The arguments of the generic type '" + AS_BLUE(ID.toUp()) +
+                    "' must be types", a->info);
+                return t;
+            }
+
+            args.push_back(arg);
+        }
+
+        if (!ID.isSimple())
+        {
+            generateError("The generic type '" + AS_BLUE(ID.toUp()) +
+                "' must have a simple id (no prefix)", INFO);
+            return t;
+        }
+
+        t.id = requestInstance(ID, args, INFO);
+
+        return t;
     }
 
-    Function *Compiler::getFunction(const Id &ID, const std::vector<std::string> &ARG_TYPES)
+    Id Compiler::requestInstance(const Id &ID, const vector<Id> &ARGS, const ErrorInfo &INFO)
     {
-        bool isEllipsis = ARG_TYPES.size() == 1 && ARG_TYPES[0] == "...";
+        const Id INSTANCE = instanceName(ID, ARGS);
 
-        for (auto f : functions)
-            if (f->id == ID)
-            {
-                // Ellipsis case
-                if (isEllipsis || (f->args.size() == 1 && f->args[0]->isEllipsis()))
-                    return f;
+        if (currentUnit)
+            currentUnit->instances.push_back({ ID, ARGS, INFO });
 
-                // Check types
-                if (f->args.size() == ARG_TYPES.size())
-                {
-                    bool compatible = true;
-                    for (size_t i = 0; i < ARG_TYPES.size(); ++i)
-                        if (!compatibleType(f->args[i]->type, ARG_TYPES[i]))
-                        {
-                            compatible = false;
-                            break;
-                        }
+        // Not instantiated yet
+        const string NAME = INSTANCE.name();
+        if (find(instances.begin(), instances.end(), NAME) == instances.end())
+        {
+            instances.push_back(NAME);
+            pendingInstances.push({ ID, ARGS, INFO });
+        }
 
-                    if (compatible)
-                        return f;
-                }
-            }
+        if (!currentInstance.empty())
+            instanceDeps[currentInstance].push_back(NAME);
 
-        // Not found
-        return nullptr;
+        return INSTANCE;
     }
 
-    Variable *Compiler::getVar(const Id &ID)
+    Id Compiler::plainType(const TypeName &TYPE, const ErrorInfo &INFO)
     {
-        for (auto i = scopes.rbegin(); i != scopes.rend(); ++i)
-            if (auto v = (*i)->getVar(ID))
-                return v;
-        
-        return nullptr;
+        if (TYPE.count != 0)
+            generateError("The type '" + AS_BLUE(TYPE.id.toUp() + "[" + to_string(TYPE.count) + "]") +
+                "' can't be used here (only constants and variables are tables)", INFO);
+
+        return TYPE.id;
     }
 
-    int Compiler::scan(const Module &MOD)
+    void Compiler::addGeneric(const GenericDecl &GENERIC)
     {
-        if (!scanner.beginParse(MOD))
+        auto other = generics.find(GENERIC.id.name());
+        if (other != generics.end())
         {
-            scanner.endParse();
-            return -1;
+            generateError("The generic type '" + AS_BLUE(GENERIC.id.toUp()) +
+                "' already exists (declared at " + other->second.info.toString() + ")", GENERIC.info);
+            return;
         }
 
-        int ret = parser.parse();
-
-        scanner.endParse();
+        for (auto &p : GENERIC.params)
+            if (p.empty())
+            {
+                generateError("The parameters of the generic type '" + AS_BLUE(GENERIC.id.toUp()) +
+                    "' must be identifiers separated by commas", GENERIC.info);
+                return;
+            }
 
-        if (ret == 0 && generationError)
-            return 1;
+        if (currentUnit)
+            currentUnit->generics.push_back(GENERIC);
 
-        return ret;
+        generics[GENERIC.id.name()] = GENERIC;
     }
 
-    void Compiler::generate()
+    int Compiler::instantiateGenerics()
     {
-        // Header //
-        program += "// Code generated by the Up compiler\n\n";
-
-        // Includes //
-        // Add all includes at the head of the source file
-        for (auto inc : includes)
-            program += "#include \"" + inc + "\"\n";
+        while (!pendingInstances.empty() && !generationError)
+        {
+            auto [id, args, info] = pendingInstances.front();
+            pendingInstances.pop();
 
-        program += '\n';
+            auto generic = generics.find(id.name());
+            if (generic == generics.end())
+            {
+                generateError("The type '" + AS_BLUE(id.toUp()) + "' is not generic", info);
+                break;
+            }
 
-        // Globals C Sections //
-        program += globalCCode;
-        program += '\n';
+            const GenericDecl &G = generic->second;
+            if (args.size() != G.params.size())
+            {
+                generateError("The generic type '" + AS_BLUE(id.toUp()) + "' has " +
+                    to_string(G.params.size()) + " parameters (not " + to_string(args.size()) + ")", info);
+                break;
+            }
 
-        // Functions //
-        // TODO : Create depedencies on functions which use other functions (add signature)
+            for (auto &arg : args)
+                if (!typeExists(arg))
+                {
+                    generateError("The type '" + AS_BLUE(arg.toUp()) + "' doesn't exist", info);
+                    return 1;
+                }
 
-        // Process functions (cdef and then up)
-        // TODO : Separate CDef and UpFunction
-        for (auto f : functions)
-            if (f->isCDef)
-                f->process(this);
-        for (auto f : functions)
-            if (!f->isCDef)
-                f->process(this);
+            // The instance is never cached (it depends on the arguments)
+            currentInstance = instanceName(id, args).name();
+            currentUnit = nullptr;
 
-        // Don't stringify program if there are errors
-        if (generationError)
-            return;
+            scanner.beginParse(G.info.file, instantiateSource(G, args), G.info.line);
+            int ret = parser.parse();
+            scanner.endParse();
 
-        // Generate all functions
-        for (size_t i = 1; i < functions.size(); ++i)
-            if (!functions[i]->isCDef)
-                program += functions[i]->toString() + "\n";
+            currentInstance = "";
 
-        // Add a return statement to main
-        auto err = ErrorInfo::empty();
-        ((UpFunction*) main())->body->
-            pushStatement(new Return(err, new Literal(err, "0", Id("int"))));
+            if (ret != 0)
+                return ret;
+        }
 
-        // Add the main function at the end
-        program += main()->toString();
+        return generationError ? 1 : 0;
     }
 
-    void Compiler::clearFunctions()
+    string Compiler::instancesCode()
     {
-        for (auto f : functions)
-            delete f;
+        string code;
+        set<string> emitted;
+
+        // Depth first (dependencies before)
+        function<void(const string&)> emit = [&](const string &NAME)
+        {
+            if (!emitted.insert(NAME).second)
+                return;
+
+            for (auto &dep : instanceDeps[NAME])
+                emit(dep);
+
+            code += instanceCode[NAME];
+        };
+
+        for (auto &name : instances)
+            emit(name);
+
+        return code;
+    }
+
+    void Compiler::addConstant(Constant *c)
+    {
+        if (Constant *other = getConstant(c->variable.id))
+        {
+            generateError("The constant '" + AS_BLUE(c->variable.id.toUp()) +
+                "' already exists (declared at " + other->info.toString() + ")", c->info);
+            return;
+        }
+
+        if (currentUnit)
+            currentUnit->constants.push_back(c);
+
+        constants.push_back(c);
+    }
+
+    Function *Compiler::lazyFunction(const ErrorInfo &INFO, const Id &TYPE, const Id &ID,
+        const std::vector<Argument*> &ARGS, const int LAZY_INDEX)
+    {
+        auto f = new UpFunction(INFO, TYPE, ID, ARGS, new Block(INFO));
+
+        if (LAZY_INDEX >= 0 && LAZY_INDEX < pendingBodies.size())
+        {
+            f->lazyBody = pendingBodies[LAZY_INDEX];
+            pendingBodies[LAZY_INDEX] = nullptr;
+        }
+
+        return f;
+    }
+
+    void Compiler::loadBody(UpFunction *f)
+    {
+        if (!f->lazyBody || f->processed)
+            return;
+
+        LazyBody *lazy = f->lazyBody;
+        f->lazyBody = nullptr;
+
+        // Parse the function again with its body (see addFunction)
+        lazyTarget = f;
+        scanner.beginParse(lazy->module, lazy->text, lazy->line);
+        parser.parse();
+        scanner.endParse();
+        lazyTarget = nullptr;
+
+        delete lazy;
+
+        // Process it like other functions
+        auto callerScopes = scopes;
+        scopes.clear();
+
+        f->process(this);
+        f->processed = true;
+
+        scopes = callerScopes;
+    }
+
+    string Compiler::prepareSource(const Module &MOD, const string &SRC)
+    {
+        // The entry is always parsed entirely
+        // Generic types are parsed for each instance
+        vector<GenericDecl> moduleGenerics;
+        string text = extractGenerics(MOD, SRC, moduleGenerics);
+
+        for (auto &g : moduleGenerics)
+            addGeneric(g);
+
+        // Generics of the imported modules, this module is parsed before them
+        static const regex USE("^use[ \t]+([a-zA-Z][a-zA-Z0-9]*(?:\\.[a-zA-Z][a-zA-Z0-9]*)*)[ \t]*(?:#.*)?$");
+        vector<GenericDecl> imported = moduleGenerics;
+        istringstream lines(text);
+        string line, content;
+        smatch match;
+        while (getline(lines, line))
+            if (regex_match(line, match, USE) && match[1] != "libc")
+            {
+                // use dir.module
+                vector<string> ids;
+                istringstream path(match[1].str());
+                for (string part; getline(path, part, '.'); )
+                    ids.push_back(part);
+
+                Id id(ids);
+                id.name() += ".up";
+
+                const Module IMPORTED(id, true, MOD.folder);
+                if (fs.read(resolvePath(IMPORTED), content))
+                    extractGenerics(IMPORTED, content, imported);
+            }
+
+        // Array is Array[num] if the generic is declared obj Array[T=num]
+        for (auto &g : imported)
+            if (hasDefaultInstance(g))
+            {
+                const string ALIASED = useDefaultInstance(g, text);
+                if (ALIASED == text)
+                    continue;
+
+                vector<Id> args;
+                for (auto &d : g.defaults)
+                    args.push_back(Id(d));
+
+                requestInstance(g.id, args, g.info);
+                text = ALIASED;
+            }
+
+        const string TEXT = text;
+
+        if (!lazyImports || resolvePath(MOD) == mainPath)
+            return TEXT;
+
+        return deferBodies(MOD, TEXT, pendingBodies);
+    }
+
+    Function *Compiler::getFunction(const Id &ID)
+    {
+        for (auto f : functions)
+            if (f->id == ID)
+                return f;
+
+        // Not found
+        return nullptr;
+    }
+
+    Function *Compiler::getFunction(const Id &ID, const std::vector<std::string> &ARG_TYPES)
+    {
+        bool isEllipsis = ARG_TYPES.size() == 1 && ARG_TYPES[0] == "...";
+
+        for (auto f : functions)
+            if (f->id == ID)
+            {
+                // Ellipsis case
+                if (isEllipsis || (f->args.size() == 1 && f->args[0]->isEllipsis()))
+                    return f;
+
+                // Check types
+                if (f->args.size() == ARG_TYPES.size())
+                {
+                    bool compatible = true;
+                    for (size_t i = 0; i < ARG_TYPES.size(); ++i)
+                        if (!compatibleType(f->args[i]->type, ARG_TYPES[i]))
+                        {
+                            compatible = false;
+                            break;
+                        }
+
+                    if (compatible)
+                        return f;
+                }
+            }
+
+        // Not found
+        return nullptr;
+    }
+
+    Constant *Compiler::getConstant(const Id &ID)
+    {
+        for (auto c : constants)
+            if (c->variable.id == ID)
+                return c;
+
+        return nullptr;
+    }
+
+    Variable *Compiler::getVar(const Id &ID)
+    {
+        for (auto i = scopes.rbegin(); i != scopes.rend(); ++i)
+            if (auto v = (*i)->getVar(ID))
+                return v;
+
+        // Global constant
+        if (auto c = getConstant(ID))
+            return &c->variable;
+        
+        return nullptr;
+    }
+
+    void Compiler::recordWrite(Variable *v, const bool C_CODE, Expression *index)
+    {
+        scopes.back()->recordWrite(v->id.toC());
+
+        auto indexUsage = dynamic_cast<VariableUsage*>(index);
+        Variable *indexVar = indexUsage ? getVar(indexUsage->id) : nullptr;
+
+        // Variables declared before a par loop can't be written by its iterations
+        // * Each iteration writes its own element of a table (t[i])
+        for (auto &shared : sharedScopes)
+        {
+            if (C_CODE || (indexVar && indexVar == shared.iterator) ||
+                find(shared.reductions.begin(), shared.reductions.end(), v) != shared.reductions.end() ||
+                find(shared.writes.begin(), shared.writes.end(), v) != shared.writes.end())
+                continue;
+
+            for (size_t i = 0; i < shared.scopeDepth; ++i)
+                if (find(scopes[i]->vars.begin(), scopes[i]->vars.end(), v) != scopes[i]->vars.end())
+                {
+                    shared.writes.push_back(v);
+                    break;
+                }
+        }
+
+        for (auto &r : loopRanges)
+            if (r.iterator == v)
+                r.modified = r.iteratorModified = true;
+            else if (r.object == v)
+                r.modified = true;
+    }
+
+    void Compiler::checkFuture(Variable *v, const ErrorInfo &INFO)
+    {
+        if (futures.count(v))
+            generateError("The value of '" + AS_BLUE(v->id.toUp()) + "' is computed by a spawned call, it can be used after a " +
+                AS_BLUE("sync"), INFO);
+    }
+
+    string Compiler::elementType(const Id &TYPE)
+    {
+        const string T = TYPE.toUp();
+
+        if (!typeExists(TYPE) || !getFunction(Id({ T, "size" }), { T }))
+            return "";
+
+        Function *getter = getFunction(Id({ T, "atGetUnchecked" }), { T, "int" });
+        if (!getter || !getFunction(Id({ T, "atSetUnchecked" }), { T, "int", getter->type.toUp() }))
+            return "";
+
+        return getter->type.toUp();
+    }
+
+    void Compiler::recordUsage(Variable *v)
+    {
+        for (auto u : usageScopes)
+            ++u->usages[v];
+    }
+
+    void Compiler::recordMethodCall(Variable *object, Call *c)
+    {
+        // Depth of the scope of the variable (0 for constants)
+        size_t depth = scopes.size();
+        while (depth > 0 && !scopes[depth - 1]->getVar(object->id))
+            --depth;
+
+        for (auto u : usageScopes)
+            if (depth <= u->scopeDepth || (u->arguments && depth == u->scopeDepth + 1))
+                u->methodCalls.push_back({ object, c });
+    }
+
+    void Compiler::checkAccess(Call *c)
+    {
+        const Id TYPE = Id(c->id.ids[0]);
+        const vector<string> ARG_TYPES = typeArgList(c->args);
+
+        if (c->args.size() < 2 || c->args[1]->type != "int" ||
+            !getFunction(Id({ TYPE.name(), "size" }), { ARG_TYPES[0] }))
+            return;
+
+        Function *unchecked = getFunction(Id({ TYPE.name(), c->id.ids[1] + "Unchecked" }), ARG_TYPES);
+        if (!unchecked)
+            return;
+
+        c->checked = true;
+        checkedAccesses.push_back(c);
+
+        // a.m(i, ...) within a loop on i and a
+        auto object = dynamic_cast<VariableUsage*>(c->args[0]);
+        auto index = dynamic_cast<VariableUsage*>(c->args[1]);
+        if (!object || !index)
+            return;
+
+        Variable *objectVar = getVar(object->id);
+        Variable *indexVar = getVar(index->id);
+        for (auto &r : loopRanges)
+            if (r.iterator == indexVar && r.object && r.object == objectVar)
+            {
+                r.accesses.push_back({ c, unchecked });
+                return;
+            }
+    }
+
+    int Compiler::load(const Module &MOD)
+    {
+        const string PATH = resolvePath(MOD);
+
+        if (cacheModules)
+        {
+            // Already parsed by a previous compilation
+            auto cached = moduleCache.find(PATH);
+            if (cached != moduleCache.end())
+            {
+                replay(cached->second);
+
+                return generationError ? 1 : 0;
+            }
+
+        }
+
+        // Precompiled module
+        const string UPM = upmPath(PATH);
+        if (useUpm && PATH != mainPath && !fs.inMemory(PATH) && upmUpToDate(UPM, PATH))
+            if (auto unit = readUpm(UPM, MOD))
+            {
+                replay(unit);
+
+                if (newUnits.find(PATH) == newUnits.end())
+                    newUnits[PATH] = unit;
+                else
+                {
+                    unit->functions.clear();
+                    unit->constants.clear();
+                    delete unit;
+                }
+
+                return generationError ? 1 : 0;
+            }
+
+        // The entry is never cached
+        if (cacheModules && PATH != mainPath && newUnits.find(PATH) == newUnits.end())
+            currentUnit = newUnits[PATH] = new ModuleUnit();
+
+        int ret = scan(MOD);
+
+        currentUnit = nullptr;
+
+        return ret;
+    }
+
+    void Compiler::replay(ModuleUnit *unit)
+    {
+        for (auto &type : unit->types)
+            type.process(this);
+
+        for (auto &[type, op] : unit->operators)
+            declareOperator(type, op);
+
+        for (auto f : unit->functions)
+            addFunction(f);
+
+        for (auto c : unit->constants)
+            addConstant(c);
+
+        for (auto &g : unit->generics)
+            addGeneric(g);
+
+        for (auto &[id, args, info] : unit->instances)
+            requestInstance(id, args, info);
+
+        globalCCode += unit->cCode;
+        precompiledCode += unit->upCode;
+
+        for (auto [mod, info] : unit->imports)
+            import(mod, info);
+    }
+
+    void Compiler::commitUnits(const bool SUCCESS)
+    {
+        for (auto [path, unit] : newUnits)
+        {
+            if (SUCCESS && unit->reusable && cacheModules)
+            {
+                moduleCache[path] = unit;
+                cachedFunctions.insert(unit->functions.begin(), unit->functions.end());
+                cachedConstants.insert(unit->constants.begin(), unit->constants.end());
+            }
+            else
+            {
+                // Functions and constants are still owned by the compiler
+                unit->functions.clear();
+                unit->constants.clear();
+                delete unit;
+            }
+        }
+
+        newUnits.clear();
+    }
+
+    int Compiler::scan(const Module &MOD)
+    {
+        if (!scanner.beginParse(MOD))
+        {
+            scanner.endParse();
+            return -1;
+        }
+
+        int ret = parser.parse();
+
+        scanner.endParse();
+
+        // Remove bodies of functions which have not been declared
+        for (auto body : pendingBodies)
+            delete body;
+        pendingBodies.clear();
+
+        if (ret == 0 && generationError)
+            return 1;
+
+        return ret;
+    }
+
+    void Compiler::processLayouts()
+    {
+        layoutCode = "";
+        layoutSummary = "";
+
+        if (layouts().empty())
+            return;
+
+        includes.insert("stdlib.h");
+
+        // The types are declared before the structs (a field can have any type)
+        string typedefs;
+        string structs;
+        string methods;
+
+        for (auto &type : layouts())
+        {
+            const string NAME = type.id.toC();
+            const bool COLLECTION = !type.soaOf.ids.empty();
+            const TypeDecl *element = COLLECTION ? layoutOf(type.soaOf) : &type;
+
+            if (!element || element->fields.empty())
+            {
+                generateError("The element type '" + AS_BLUE(type.soaOf.toUp()) + "' of the collection '" +
+                    AS_BLUE(type.id.toUp()) + "' must be an obj with fields", type.info);
+                continue;
+            }
+
+            // The fields of the element are checked with the element
+            if (!COLLECTION)
+                for (auto &f : type.fields)
+                    if (!typeExists(f.type) || f.type == "nil")
+                        generateError("The type '" + AS_BLUE(f.type.toUp()) + "' of the field '" +
+                            AS_BLUE(f.id.toUp()) + "' isn't declared", type.info);
+
+            typedefs += "typedef struct _" + NAME + " _" + NAME + ";\n";
+            typedefs += "typedef _" + NAME + "* " + NAME + ";\n";
+
+            int size;
+            int align;
+            const auto OFFSETS = element->offsets(size, align);
+            // Alignment of the object or of the arrays of the collection
+            const int DECLARED_ALIGN = type.declaredAlign();
+
+            // For example :
+            // float x; (object), float *x; (collection)
+            string members;
+            // Arguments of the constructors and their names
+            string params;
+            string args;
+            // Body of init and fini
+            string init;
+            string fini;
+
+            for (size_t i = 0; i < element->fields.size(); ++i)
+            {
+                const Field &F = element->fields[i];
+                const string FIELD = F.id.toC();
+                const string TYPE = cType(F.type.toUp());
+
+                if (COLLECTION)
+                {
+                    members += "\t" + TYPE + " *" + FIELD + ";\n";
+                    fini += "\tfree(me->" + FIELD + ");\n";
+
+                    if (DECLARED_ALIGN)
+                    {
+                        // The size must be a multiple of the alignment
+                        const string A = to_string(DECLARED_ALIGN);
+                        const string BYTES = "count * sizeof(" + TYPE + ")";
+
+                        init += "\tme->" + FIELD + " = aligned_alloc(" + A + ", (" + BYTES + " + " + A +
+                            " - 1) / " + A + " * " + A + ");\n";
+                        init += "\tmemset(me->" + FIELD + ", 0, " + BYTES + ");\n";
+                    }
+                    else
+                        init += "\tme->" + FIELD + " = calloc(count, sizeof(" + TYPE + "));\n";
+                }
+                else
+                {
+                    members += "\t" + TYPE + " " + FIELD;
+                    if (OFFSETS[i].declaredAlign)
+                        members += " __attribute__((aligned(" + to_string(OFFSETS[i].declaredAlign) + ")))";
+                    members += ";\n";
+
+                    params += ", " + TYPE + " " + FIELD;
+                    args += ", " + FIELD;
+                    init += "\tme->" + FIELD + " = " + FIELD + ";\n";
+                }
+            }
+
+            if (COLLECTION)
+            {
+                members += "\tint _upCount;\n";
+                params = ", int count";
+                args = ", count";
+                init += "\tme->_upCount = count;\n";
+
+                if (DECLARED_ALIGN)
+                    includes.insert("string.h");
+            }
+
+            // Without the first comma
+            const string NEW_PARAMS = params.empty() ? "" : params.substr(2);
+
+            // For example :
+            // __attribute__((packed, aligned(64)))
+            string attributes;
+            if (!COLLECTION && type.attributes.packed)
+                attributes += "packed";
+            if (!COLLECTION && DECLARED_ALIGN)
+                attributes += (attributes.empty() ? "" : ", ") + string("aligned(") + to_string(DECLARED_ALIGN) + ")";
+            if (!attributes.empty())
+                attributes = "__attribute__((" + attributes + ")) ";
+
+            // malloc aligns to 16 bytes
+            const string ALLOC = !COLLECTION && align > 16 ?
+                "aligned_alloc(_Alignof(_" + NAME + "), sizeof(_" + NAME + "))" :
+                "malloc(sizeof(_" + NAME + "))";
+
+            structs += "struct " + attributes + "_" + NAME + "\n{\n" + members + "};\n\n";
+
+            methods +=
+                "void " + NAME + "_init(" + NAME + " me" + params + ")\n{\n" + init + "}\n\n" +
+                "void " + NAME + "_fini(" + NAME + " me)\n{\n" + fini + "}\n\n" +
+                NAME + " " + NAME + "_new(" + NEW_PARAMS + ")\n{\n" +
+                "\t" + NAME + " me = " + ALLOC + ";\n" +
+                "\t" + NAME + "_init(me" + args + ");\n" +
+                "\treturn me;\n}\n\n" +
+                "void " + NAME + "_del(" + NAME + " me)\n{\n" +
+                "\t" + NAME + "_fini(me);\n" +
+                "\tfree(me);\n}\n\n";
+
+            if (COLLECTION)
+                methods += "int " + NAME + "_size(" + NAME + " me)\n{\n\treturn me->_upCount;\n}\n\n";
+
+            layoutSummary += layoutReportOf(type, COLLECTION ? *element : type);
+        }
+
+        layoutCode = typedefs + "\n" + structs + methods;
+    }
+
+    string Compiler::layoutReportOf(const TypeDecl &TYPE, const TypeDecl &ELEMENT) const
+    {
+        int size;
+        int align;
+        const auto OFFSETS = ELEMENT.offsets(size, align);
+
+        // Attributes of a type or a field (with a comma before each one)
+        auto attributes = [](const LayoutAttributes &ATTRIBUTES)
+        {
+            string s;
+            if (ATTRIBUTES.packed)
+                s += ", packed";
+            if (ATTRIBUTES.align)
+                s += ", align(" + to_string(ATTRIBUTES.align) + ")";
+            if (ATTRIBUTES.cacheline)
+                s += ", cacheline";
+
+            return s;
+        };
+
+        auto bytes = [](const int N)
+        { return to_string(N) + (N == 1 ? " byte" : " bytes"); };
+
+        const string TYPE_ATTRIBUTES = attributes(TYPE.attributes);
+        string report = TYPE.id.toUp() + (TYPE_ATTRIBUTES.empty() ? "" : " (" + TYPE_ATTRIBUTES.substr(2) + ")");
+
+        // One array per field
+        if (&TYPE != &ELEMENT)
+        {
+            int element = 0;
+            for (auto &o : OFFSETS)
+                element += o.size;
+
+            return report + " : soa of " + ELEMENT.id.toUp() + ", " + bytes(element) +
+                " per element in " + to_string(OFFSETS.size()) + " arrays\n";
+        }
+
+        int padding = size;
+        for (auto &o : OFFSETS)
+            padding -= o.size;
+
+        report += " : " + bytes(size) + ", alignment " + to_string(align) + ", " +
+            bytes(padding) + " of padding\n";
+
+        int end = 0;
+        for (size_t i = 0; i < OFFSETS.size(); ++i)
+        {
+            const auto &O = OFFSETS[i];
+            const Field &F = ELEMENT.fields[i];
+
+            if (O.padding)
+                report += "\t" + to_string(O.offset - O.padding) + "\t" + bytes(O.padding) + " of padding\n";
+
+            report += "\t" + to_string(O.offset) + "\t" + F.type.toUp() + " " + F.id.toUp() +
+                " (" + bytes(O.size) + attributes(F.attributes) + ")\n";
+
+            end = O.offset + O.size;
+        }
+
+        if (size > end)
+            report += "\t" + to_string(end) + "\t" + bytes(size - end) + " of padding (end)\n";
+
+        return report;
+    }
+
+    int Compiler::tableSize(const Id &ID, Expression *size, const ErrorInfo &INFO)
+    {
+        // Like Constant::process, the variables of a function are not visible
+        Block scope(INFO);
+        auto callerScopes = scopes;
+        auto callerFunction = currentFunction;
+        scopes = { &scope };
+        currentFunction = nullptr;
+
+        size->process(this);
+
+        scopes = callerScopes;
+        currentFunction = callerFunction;
+
+        if (size->type != "int" || !Interpreter::isConstant(this, size))
+        {
+            generateError("The size of the table must be a constant " + AS_BLUE("int") + " (" +
+                AS_BLUE(ID.toUp() + "[16]") + " or " + AS_BLUE(ID.toUp() + "[SIZE]") + ")", INFO);
+            return 1;
+        }
+
+        Interpreter interpreter(this);
+        Value count;
+        if (!interpreter.evaluate(size, {}, count))
+            return 1;
+
+        if (count.i <= 0)
+        {
+            generateError("The size of a table must be positive", INFO);
+            return 1;
+        }
+
+        return count.i;
+    }
+
+    void Compiler::processConstants()
+    {
+        // * Constants of cached modules are already processed
+        for (auto c : constants)
+            if (!c->processed)
+                c->process(this);
+    }
+
+    void Compiler::evaluateConstants()
+    {
+        // Functions called by constants have been inferred
+        // * Stops at the first error (the next constants may depend on it)
+        for (auto c : constants)
+            if (!c->evaluate(this))
+                break;
+    }
+
+    void Compiler::processFunctions()
+    {
+        // Process functions (cdef and then up)
+        // TODO : Separate CDef and UpFunction
+        // * Functions of cached modules are already processed
+        for (auto f : functions)
+            if (f->isCDef && !f->processed)
+            {
+                f->process(this);
+                f->processed = true;
+            }
+        // * Lazy functions are processed when they are called
+        // * The calls of cached functions request their copies again,
+        //   in the same order as if they were processed
+        for (auto f : functions)
+            if (!f->isCDef && !f->processed && !isLazy(f))
+            {
+                f->process(this);
+                f->processed = true;
+            }
+            else if (auto upFunc = dynamic_cast<UpFunction*>(f); upFunc && upFunc->processed)
+                for (auto &[callee, values] : upFunc->specializedCalls)
+                    callee->addSpecialization(values);
+    }
+
+    void Compiler::restrictObjects()
+    {
+        // Whether the call reads (1) or writes (2) an element without check
+        auto elementAccess = [](const Call *C) -> int
+        {
+            const string NAME = C->function->id.name();
+            const string SUFFIX = "Unchecked";
+
+            if (NAME.size() <= SUFFIX.size() || NAME.compare(NAME.size() - SUFFIX.size(), SUFFIX.size(), SUFFIX) != 0 ||
+                C->args.size() < 2 || C->args[1]->type != "int")
+                return 0;
+
+            if (C->function->type != "nil" && C->args.size() == 2)
+                return 1;
+
+            if (C->function->type == "nil" && C->args.size() == 3)
+                return 2;
+
+            return 0;
+        };
+
+        // * Functions and outer loops first, the inner loops don't
+        //   declare the pointers again
+        for (auto u : processedUsages)
+        {
+            map<Variable*, vector<Call*>> objects;
+            for (auto [v, c] : u->methodCalls)
+                objects[v].push_back(c);
+
+            for (auto &[v, calls] : objects)
+            {
+                // The pointers of a function are created before its variables
+                if (!v->noalias && (u->arguments || !(v->constructed && !v->escapes)))
+                    continue;
+
+                if (u->usages[v] > 0)
+                    continue;
+
+                bool accessed = false;
+                bool restricted = true;
+                for (auto c : calls)
+                {
+                    if (!c->function || !c->dataPointer.empty())
+                        restricted = false;
+                    else if (elementAccess(c))
+                        accessed = true;
+                    else if (c->function->id.name() != "size" || c->args.size() != 1)
+                        restricted = false;
+                }
+
+                if (!restricted || !accessed)
+                    continue;
+
+                u->restricted.push_back(v);
+
+                for (auto c : calls)
+                    if (elementAccess(c))
+                        c->dataPointer = "_upData_" + v->id.toC();
+            }
+        }
+    }
+
+    void Compiler::reportBounds()
+    {
+        boundsSummary = "";
+
+        // In order of location
+        stable_sort(checkedAccesses.begin(), checkedAccesses.end(), [](Call *a, Call *b)
+            {
+                const string A = a->info.file.path(), B = b->info.file.path();
+
+                return A != B ? A < B : a->info.line != b->info.line ?
+                    a->info.line < b->info.line : a->info.column < b->info.column;
+            });
+
+        size_t removed = 0;
+        for (auto c : checkedAccesses)
+        {
+            const auto &INFO = c->info;
+
+            boundsSummary += INFO.file.path() + ":" + to_string(INFO.line) + ":" + to_string(INFO.column) +
+                " : " + c->id.toUp() + (c->unchecked ? " (check removed)" : " (checked)") + "\n";
+
+            if (c->unchecked)
+                ++removed;
+        }
+
+        boundsSummary += to_string(removed) + " of " + to_string(checkedAccesses.size()) +
+            " bounds checks removed\n";
+    }
+
+    void Compiler::releaseBorrowed()
+    {
+        for (auto [block, f] : processedBlocks)
+            block->releaseBorrowed(f);
+
+        // The returns set _upReturning if a cleanup checks it
+        for (auto [block, f] : processedBlocks)
+            if (block == f->body)
+                for (auto r : f->returns)
+                    r->setsReturning = f->checksReturning;
+    }
+
+    void Compiler::optimizeCalls()
+    {
+        // Functions of cached modules have already been inferred
+        vector<UpFunction*> upFunctions;
+        for (size_t i = 1; i < functions.size(); ++i)
+            if (auto f = dynamic_cast<UpFunction*>(functions[i]))
+                if (!isLazy(f) && cachedFunctions.find(f) == cachedFunctions.end())
+                    upFunctions.push_back(f);
+
+        // Purity without calls
+        auto localPurity = [](UpFunction *f) -> Purity
+        {
+            if (f->hasSideEffects)
+                return Purity::Impure;
+
+            // Objects are pointers to memory
+            for (auto a : f->args)
+                if (a->type != "int" && a->type != "num" && a->type != "bool")
+                    return Purity::Pure;
+
+            return Purity::Const;
+        };
+
+        // Start from the local purity, calls can only decrease it
+        // * Recursive functions are pure if nothing else is impure
+        for (auto f : upFunctions)
+            f->purity = max(localPurity(f), f->modifiers.purity);
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            for (auto f : upFunctions)
+            {
+                Purity purity = localPurity(f);
+                for (auto callee : f->callees)
+                    purity = min(purity, callee->purity);
+
+                // The declaration has the priority
+                purity = max(purity, f->modifiers.purity);
+
+                if (purity != f->purity)
+                {
+                    f->purity = purity;
+                    changed = true;
+                }
+            }
+        }
+
+        // A cached result would skip side effects
+        for (auto f : upFunctions)
+            if (f->modifiers.memo && f->purity == Purity::Impure)
+                generateError("The function '" + AS_BLUE(f->id.toUp()) +
+                    "' can't be memoized because it has side effects (declare it " +
+                    AS_BLUE("pure") + " if they can be skipped)", f->info);
+
+        for (auto [block, f] : processedBlocks)
+            block->eliminateCalls(f);
+    }
+
+    void Compiler::generate()
+    {
+        // Header //
+        program += "// Code generated by the Up compiler\n\n";
+
+        // Includes //
+        // Add all includes at the head of the source file
+        for (auto inc : includes)
+            program += "#include \"" + inc + "\"\n";
+
+        program += '\n';
+
+        // Globals C Sections //
+        program += globalCCode;
+        program += '\n';
+
+        // Instances of generic types //
+        program += instancesCode();
+
+        // Types with fields //
+        program += layoutCode;
+
+        // Constants //
+        for (auto c : constants)
+            program += c->toString();
+
+        if (!constants.empty())
+            program += '\n';
+
+        // Precompiled functions //
+        program += precompiledCode;
+
+        // Purity of cdef functions //
+        // * Declared with the attribute, the function may not be
+        //   declared by a header
+        bool attributes = false;
+        for (auto f : functions)
+            if (f->isCDef && !f->attribute().empty())
+            {
+                program += f->signature() + " " + f->attribute() + ";\n";
+                attributes = true;
+            }
+
+        if (attributes)
+            program += '\n';
+
+        // Functions //
+        // TODO : Create depedencies on functions which use other functions (add signature)
+
+        // Generate all functions
+        for (size_t i = 1; i < functions.size(); ++i)
+            if (!functions[i]->isCDef && !isLazy(functions[i]))
+                program += functions[i]->toString() + "\n";
+
+        // Add the main function at the end
+        program += main()->toString();
+
+        // Flags //
+        // * Precompiled functions keep the features of their body
+        bool simd = false, par = false, spawn = false;
+        for (auto f : functions)
+        {
+            simd |= f->usesSimd;
+            par |= f->usesPar;
+            spawn |= f->usesSpawn;
+        }
+
+        // OpenMP includes simd
+        if (par)
+            gccFlags += " -fopenmp";
+        else if (simd)
+            gccFlags += " -fopenmp-simd";
+
+        if (spawn)
+            gccFlags += " -pthread";
+    }
+
+    bool Compiler::isLazy(Function *f)
+    {
+        auto upFunc = dynamic_cast<UpFunction*>(f);
+
+        return upFunc && upFunc->lazyBody;
+    }
+
+    void Compiler::clearFunctions()
+    {
+        for (auto f : functions)
+            if (cachedFunctions.find(f) == cachedFunctions.end())
+                delete f;
+
+        for (auto c : constants)
+            if (cachedConstants.find(c) == cachedConstants.end())
+                delete c;
 
         functions.clear();
+        constants.clear();
     }
 } // namespace up
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <queue>
 
 #include "scanner.h"
@@ -10,11 +11,14 @@
 #include "parser.hpp" 
 #include "module.h"
 #include "error_info.h"
+#include "diagnostic.h"
+#include "vfs.h"
+#include "module_unit.h"
+#include "lazy.h"
+#include "generic.h"
 
 namespace up
 {
-    class TypeDecl;
-
     // Main class which parses and then transpile the up code
     class Compiler
     {
@@ -28,6 +32,43 @@ namespace up
         // Returns 0 if no error
         int parse(const std::string &FILE_PATH, std::ostream &programOut);
 
+        // Compiles the main Up source file to C
+        // The C code is then available with output()
+        // Returns 0 if no error
+        int compile(const std::string &FILE_PATH);
+
+        // The C program generated by the last compilation
+        inline const std::string &output() const
+        { return program; }
+
+        // Sizes and padding of the types with fields of the last
+        // compilation (x86-64)
+        inline const std::string &layoutReport() const
+        { return layoutSummary; }
+
+        // Checked accesses of the last compilation and whether
+        // their check has been removed (see checkAccess)
+        inline const std::string &boundsReport() const
+        { return boundsSummary; }
+
+        // Removes the module located at PATH from the cache
+        // and all modules which import it
+        void invalidateModule(const std::string &PATH);
+
+        // Removes all modules of the cache
+        void clearModuleCache();
+
+        // Files of the modules within the cache
+        std::vector<std::string> cachedModules() const;
+
+        // Precompiles the module located at SOURCE to the .upm file OUT
+        // Returns 0 if no error
+        int emitModule(const std::string &SOURCE, const std::string &OUT);
+
+        // Returns the file where the module is located
+        // (relative to the importer or in the include directory)
+        std::string resolvePath(const Module &MOD) const;
+
         // Creates and display a generation error
         void generateError(const std::string &MSG, const ErrorInfo &INFO, const std::string &REASON="Generation");
 
@@ -42,14 +83,42 @@ namespace up
         void import(Module mod, const ErrorInfo &INFO);
 
         // Adds a new type (with obj keyword)
+        // * Declares the constructors and destructors of a type
+        //   with fields or a soa layout
         void newType(TypeDecl &type);
         
         // Adds a function to the functions list
         void addFunction(Function *f);
 
+        // Returns the type ID[ARGS] and instantiates it if ID is generic
+        // * A table has one constant int argument (num[16], num[SIZE * 2])
+        TypeName genericType(const Id &ID, const std::vector<Expression*> &ARGS, const ErrorInfo &INFO);
+
+        // Returns the id of the type, which can't be a table
+        Id plainType(const TypeName &TYPE, const ErrorInfo &INFO);
+
+        // Returns the name of the instance ID[ARGS], which is parsed
+        // by instantiateGenerics if it is not instantiated yet
+        Id requestInstance(const Id &ID, const std::vector<Id> &ARGS, const ErrorInfo &INFO);
+
+        // Adds a global constant (see Constant)
+        void addConstant(Constant *c);
+
+        // Creates an up function whose body is parsed later
+        // * LAZY_INDEX refers to the placeholder of the body
+        Function *lazyFunction(const ErrorInfo &INFO, const Id &TYPE, const Id &ID,
+            const std::vector<Argument*> &ARGS, const int LAZY_INDEX);
+
+        // Parses and processes the body of a lazy function
+        // * Does nothing if the body is already parsed
+        void loadBody(UpFunction *f);
+
+        // Returns the source of the module to scan
+        // (bodies of imported modules are removed in lazy mode)
+        std::string prepareSource(const Module &MOD, const std::string &SRC);
+
         // Add c section in global scope
-        inline void addGlobalCCode(const std::string &CODE)
-        { globalCCode += "\n" + CODE + "\n"; }
+        void addGlobalCCode(const std::string &CODE);
 
         // Finds a function
         // !!! Can return nullptr if the function is not found
@@ -57,18 +126,129 @@ namespace up
         Function *getFunction(const Id &ID);
         Function *getFunction(const Id &ID, const std::vector<std::string> &ARG_TYPES);
 
-        // Returns the variable in the current scope
+        // Finds a global constant
+        // !!! Can return nullptr
+        Constant *getConstant(const Id &ID);
+
+        // Returns the variable in the current scope (or a constant)
         // !!! Might return nullptr
         Variable *getVar(const Id &ID);
 
+        // Records the write of v in the current block
+        // (reused calls, ranges of the loops and shared variables)
+        // * C_CODE : v is used by a C section (it may be written), these
+        //   writes are not checked by par loops
+        // * index : the index of the written element if v is a table
+        void recordWrite(Variable *v, const bool C_CODE=false, Expression *index=nullptr);
+
+        // Reports the usage of v if it is a future which is not synced
+        void checkFuture(Variable *v, const ErrorInfo &INFO);
+
+        // Removes the check of the call if its index is the iterator
+        // of a loop within the bounds of the object (see LoopRange)
+        // * A checked access is a method T.m(int i, ...) of a type
+        //   with T.size() and T.mUnchecked(int i, ...)
+        void checkAccess(Call *c);
+
+        // Returns the up type of the elements of an array type
+        // (element-wise operations), empty if TYPE is not an array
+        // * An array type declares T.size(), T.atGetUnchecked(int i) and
+        //   T.atSetUnchecked(int i, E val)
+        std::string elementType(const Id &TYPE);
+
+        // Records the usage of v in the functions and the loops being processed
+        // (except as the object of a method call, see recordMethodCall)
+        void recordUsage(Variable *v);
+
+        // Records the method call on the object in the functions
+        // and the loops being processed
+        // * Only variables declared before the loop are recorded
+        void recordMethodCall(Variable *object, Call *c);
+
     public:
+        // Files read by the scanner (in memory or on the disk)
+        VirtualFS fs;
+
+        // The folder of the standard modules (ends with a slash), the
+        // include directory of this repo by default (see initGlobal)
+        std::string includeDir;
+
+        // Errors of the last compilation
+        std::vector<Diagnostic> diagnostics;
+
+        // gcc flags required by the C of the last compilation, each
+        // flag begins with a space (see generate)
+        // For example :
+        // " -fopenmp -pthread"
+        std::string gccFlags;
+
+        // Where errors are displayed, nullptr to display nothing
+        std::ostream *errorStream = &std::cerr;
+
+        // Whether imported modules are parsed once and then
+        // reused by the next compilations
+        bool cacheModules = false;
+
+        // Whether up to date precompiled modules (.upm) are
+        // loaded instead of their source
+        bool useUpm = true;
+
+        // Whether compilations stop after checking the program
+        // (no C code is generated)
+        bool checkOnly = false;
+
+        // Whether bodies of functions within imported modules are
+        // parsed only when these functions are called
+        bool lazyImports = false;
+
+        // Whether memoized functions display the hits and
+        // misses of their cache at exit
+        bool memoStats = false;
+
+        // Maximum number of copies of an up function for calls
+        // with literal arguments (0 to disable)
+        int maxSpecializations = 4;
+
         // The first function is the main function
         std::vector<Function*> functions;
         
+        // Global constants (tables and values)
+        std::vector<Constant*> constants;
+
         // Gathers all blocks in the process function
         // Used to find variables in the process function
         std::vector<Block*> scopes;
 
+        // The up function being processed
+        UpFunction *currentFunction = nullptr;
+
+        // Blocks processed by this compilation and their function
+        std::vector<std::pair<Block*, UpFunction*>> processedBlocks;
+
+        // Accesses of tables with a constant index, checked
+        // after the evaluation of the constants
+        std::vector<Index*> constantIndices;
+
+        // Ranges of the loops being processed (the innermost is the last)
+        std::vector<LoopRange> loopRanges;
+
+        // Par loops being processed (the innermost is the last)
+        std::vector<SharedScope> sharedScopes;
+
+        // Futures whose spawned call is not synced (see Spawn)
+        std::set<Variable*> futures;
+
+        // Element-wise operations of the statement being processed which
+        // are not assigned to an array (errors)
+        std::set<Expression*> unassignedOperations;
+
+        // Objects used by the functions and the loops being processed
+        // (the innermost is the last)
+        std::vector<ObjectUsages*> usageScopes;
+        // Objects used by the functions and the loops processed
+        // by this compilation (outer scopes first)
+        std::vector<ObjectUsages*> processedUsages;
+
     private:
         // Returns the main function
         inline Function *main()
@@ -76,10 +256,78 @@ namespace up
 
         // Calls the scanner to create components
         int scan(const Module &MOD);
+
+        // Scans the module or reuses its cached declarations
+        int load(const Module &MOD);
+
+        // Adds the declarations of a cached module
+        void replay(ModuleUnit *unit);
+
+        // Adds modules parsed by this compilation to the cache
+        // if SUCCESS, otherwise they are removed
+        void commitUnits(const bool SUCCESS);
         
-        // Generates the program with all scanned components
+        // Declares a generic obj (see GenericDecl)
+        void addGeneric(const GenericDecl &GENERIC);
+
+        // Parses the instances of generic types used by the program
+        // * Instances are parsed once per compilation, even if the
+        //   same type is used by several modules
+        // Returns 0 if no error
+        int instantiateGenerics();
+
+        // C sections of the instances, an instance is
+        // after the instances used by its declarations
+        std::string instancesCode();
+
+        // Generates the structs, constructors and destructors
+        // of the types with fields or a soa layout
+        void processLayouts();
+
+        // Offsets of the fields of TYPE (see layoutReport)
+        // * ELEMENT is TYPE or the element of the collection TYPE
+        std::string layoutReportOf(const TypeDecl &TYPE, const TypeDecl &ELEMENT) const;
+
+        // Evaluates the constant int expression SIZE of the table ID[SIZE]
+        // Returns 1 if there is an error (a table of one value)
+        // * The constants of SIZE are declared before the table
+        int tableSize(const Id &ID, Expression *size, const ErrorInfo &INFO);
+
+        // Checks the expressions of scanned constants
+        void processConstants();
+
+        // Computes the values of the constants
+        // (after the purity inference of the called functions)
+        void evaluateConstants();
+
+        // Checks all scanned functions (semantic errors)
+        void processFunctions();
+
+        // Lists the checked accesses (see boundsReport)
+        void reportBounds();
+
+        // Accesses the elements of distinct objects with restrict pointers
+        // within the functions and the loops where they are used only by
+        // size() and unchecked accesses (see checkAccess)
+        // * An object is distinct if it is a noalias argument or a
+        //   constructed variable which doesn't escape (loops only)
+        // * The elements are stored in the member data (Array)
+        void restrictObjects();
+
+        // Removes the cleanups of the variables which don't own their
+        // object (see Block::releaseBorrowed)
+        void releaseBorrowed();
+
+        // Infers the purity of up functions processed by this compilation
+        // (see Purity) and then reuses their redundant calls
+        void optimizeCalls();
+
+        // Generates the program with all processed components
         void generate();
 
+        // Whether the body of f is not parsed yet
+        bool isLazy(Function *f);
+
         // Removes each function in functions
         void clearFunctions();
 
@@ -97,6 +345,38 @@ namespace up
 
         // The main file (entry)
         std::string mainFile;
+        // Its resolved path
+        std::string mainPath;
+
+        // Parsed modules by resolved path
+        std::map<std::string, ModuleUnit*> moduleCache;
+        // Modules parsed by the current compilation
+        // (added to the cache only if there is no error)
+        std::map<std::string, ModuleUnit*> newUnits;
+        // The module being scanned, nullptr if it can't be cached
+        ModuleUnit *currentUnit = nullptr;
+        // Functions owned by cached modules
+        std::set<Function*> cachedFunctions;
+        // Constants owned by cached modules
+        std::set<Constant*> cachedConstants;
+
+        // Generic types by name
+        std::map<std::string, GenericDecl> generics;
+        // Instances to parse (generic, type arguments)
+        std::queue<std::tuple<Id, std::vector<Id>, ErrorInfo>> pendingInstances;
+        // Parsed and pending instances (in order of use)
+        std::vector<std::string> instances;
+        // Instance being parsed (empty if none)
+        std::string currentInstance;
+        // C sections of each instance
+        std::map<std::string, std::string> instanceCode;
+        // Instances used by the declarations of each instance
+        std::map<std::string, std::vector<std::string>> instanceDeps;
+
+        // Bodies removed from the module being scanned (lazy mode)
+        std::vector<LazyBody*> pendingBodies;
+        // The function whose body is being parsed (lazy mode)
+        UpFunction *lazyTarget = nullptr;
 
         // The program in string
         std::string program;
@@ -104,6 +384,19 @@ namespace up
         // C code sections (global scope)
         std::string globalCCode;
 
+        // Types with fields and soa collections (C code)
+        std::string layoutCode;
+        // See layoutReport
+        std::string layoutSummary;
+
+        // Checked accesses processed by this compilation
+        std::vector<Call*> checkedAccesses;
+        // See boundsReport
+        std::string boundsSummary;
+
+        // Up functions of precompiled modules (C code)
+        std::string precompiledCode;
+
         // Whether the generation contains errors
         bool generationError = false;
     };
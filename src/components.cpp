@@ -1,13 +1,71 @@
 #include "components.h"
 
+#include <cctype>
+#include <set>
+#include <map>
+#include <algorithm>
+
 #include "compiler.h"
 #include "types.h"
 #include "colors.h"
+#include "lazy.h"
+#include "interpreter.h"
+#include "spawn.h"
 
 using namespace std;
 
 namespace up
 {
+    namespace
+    {
+        // Minimum number of cases (without or) to emit a switch
+        // * Shorter sequences stay if / else if
+        const size_t MIN_SWITCH_CASES = 3;
+
+        // Checks the operator of an assignment (=, += ...) with the type of the expression
+        void checkAssignOperator(Compiler *compiler, const Id &TYPE, const string &OPERAND, const ErrorInfo &INFO)
+        {
+            // Check operator declared (or expression operator)
+            if (OPERAND.size() > 1)
+            {
+                const string OP = string(1, OPERAND[0]);
+                if (!operatorExists(TYPE, OP))
+                    compiler->generateError("The operator '" + AS_BLUE(OPERAND) +
+                        "' (or '" + AS_BLUE(OP) + "') can't be used with the type '" +
+                        AS_BLUE(TYPE.toUp()) + "'",
+                        INFO);
+            }
+            else if (!operatorExists(TYPE, OPERAND))
+                compiler->generateError("The operator '" + AS_BLUE(OPERAND) +
+                    "' can't be used with the type '" + AS_BLUE(TYPE.toUp()) + "'",
+                    INFO);
+        }
+
+        // Whether the variable owns its object (see Variable::creators)
+        bool ownsObject(Variable *v)
+        {
+            if (v->borrows || v->creators.empty())
+                return false;
+
+            for (auto f : v->creators)
+                if (f->returnsBorrowed())
+                    return false;
+
+            return true;
+        }
+
+        // Records the value assigned to the variable (see Variable::creators)
+        void recordSource(Variable *v, Expression *value)
+        {
+            auto call = dynamic_cast<Call*>(value);
+
+            if (call && call->function)
+                v->creators.push_back(call->function);
+            else
+                v->borrows = true;
+        }
+    } // namespace
+
     Expression::Expression(const ErrorInfo &INFO, const Id &TYPE)
         : ISyntax(INFO), type(TYPE)
     {}
@@ -19,6 +77,11 @@ namespace up
             || TYPE == type;
     }
 
+    Id Expression::typeName(Compiler *compiler) const
+    {
+        return Id();
+    }
+
     ExpressionStatement::ExpressionStatement(const ErrorInfo &INFO, Expression *expr)
         : Statement(INFO), expr(expr)
     {}
@@ -48,7 +111,58 @@ namespace up
     {
         return "\n" + code + "\n";
     }
+
+    void CStatement::process(Compiler *compiler)
+    {
+        // Variables used in C escape
+        for (auto scope : compiler->scopes)
+            for (auto v : scope->vars)
+            {
+                const string ID = v->id.toC();
+
+                for (size_t i = code.find(ID); i != string::npos; i = code.find(ID, i + 1))
+                {
+                    // Whole word only
+                    const size_t END = i + ID.size();
+                    if ((i == 0 || !(isalnum(code[i - 1]) || code[i - 1] == '_')) &&
+                        (END == code.size() || !(isalnum(code[END]) || code[END] == '_')))
+                    {
+                        // The C code may also modify it
+                        v->escapes = true;
+                        compiler->recordWrite(v, true);
+                        compiler->recordUsage(v);
+                        break;
+                    }
+                }
+            }
+
+        // The C code may do anything
+        if (compiler->currentFunction)
+            compiler->currentFunction->hasSideEffects = true;
+    }
     
+    string LoopHints::toString() const
+    {
+        string s;
+
+        string clauses;
+        for (auto &r : reductions)
+            clauses += " reduction(" + r.op + ": " + r.id.toC() + ")";
+
+        if (par)
+            s += "#pragma omp parallel for" + string(simd ? " simd" : "") + clauses + "\n\t";
+        else if (simd)
+            s += "#pragma omp simd" + clauses + "\n\t";
+
+        if (ivdep)
+            s += "#pragma GCC ivdep\n\t";
+
+        if (unroll)
+            s += "#pragma GCC unroll " + to_string(unroll) + "\n\t";
+
+        return s;
+    }
+
     IMonoBlockStatement::IMonoBlockStatement(const ErrorInfo &INFO, Block *content)
         : IBlockStatement(INFO), content(content)
     {}
@@ -58,9 +172,43 @@ namespace up
         delete content;
     }
 
-    void IMonoBlockStatement::pushDestructor(const string &DES)
+    void IMonoBlockStatement::setCleanupExit(const int LABEL)
     {
-        content->destructors += DES;
+        content->exitLabel = LABEL;
+    }
+
+    void IMonoBlockStatement::processLoop(Compiler *compiler)
+    {
+        UpFunction *f = compiler->currentFunction;
+        const int LABELS = f ? f->cleanupLabels : 0;
+        const size_t RETURNS = f ? f->returns.size() : 0;
+
+        content->process(compiler);
+
+        if (!hints.any() || !f)
+            return;
+
+        f->usesSimd |= hints.simd;
+        f->usesPar |= hints.par;
+
+        const string KIND = hints.par ? "par" : "simd";
+
+        // gcc expects the loop right after #pragma omp
+        if ((hints.simd || hints.par) && (hints.ivdep || hints.unroll))
+            compiler->generateError("A " + AS_BLUE(KIND) + " loop can't be " + AS_BLUE("ivdep") +
+                " or unrolled", info);
+
+        if (!hints.reductions.empty() && !hints.simd && !hints.par)
+            compiler->generateError("Only " + AS_BLUE("par") + " and " + AS_BLUE("simd") +
+                " loops have reductions", info);
+
+        // Each thread destroys its objects
+        if (f->cleanupLabels != LABELS && (hints.simd || hints.ivdep || hints.unroll))
+            compiler->generateError("An annotated loop can't declare objects with a destructor", info);
+
+        // No branch out of the loop
+        if ((hints.simd || hints.par) && f->returns.size() != RETURNS)
+            compiler->generateError("A " + AS_BLUE(KIND) + " loop can't return", info);
     }
 
     ControlStatement::ControlStatement(const ErrorInfo &INFO, Expression *condition, Block *content, const string &KEYWORD)
@@ -74,7 +222,7 @@ namespace up
 
     string ControlStatement::toString() const
     {
-        string s = keyword;
+        string s = hints.toString() + keyword;
         s += " (";
         s += condition->toString();
         s += ") ";
@@ -85,8 +233,11 @@ namespace up
 
     void ControlStatement::process(Compiler *compiler)
     {
+        if (hints.simd || hints.par)
+            compiler->generateError("Only for loops can be " + AS_BLUE("simd") + " or " + AS_BLUE("par"), info);
+
         condition->process(compiler);
-        content->process(compiler);
+        processLoop(compiler);
 
         if (condition->type != "bool")
         {
@@ -96,6 +247,20 @@ namespace up
         }
     }
 
+    Literal *ControlStatement::caseValue(VariableUsage *&variable) const
+    {
+        auto op = dynamic_cast<BinaryOperation*>(condition);
+
+        return op ? op->intEquality(variable) : nullptr;
+    }
+
+    string ControlStatement::toCaseString() const
+    {
+        VariableUsage *variable;
+
+        return "case " + caseValue(variable)->toString() + ": " + content->toString() + "\tbreak;\n";
+    }
+
     ConditionSequence::ConditionSequence(const ErrorInfo &INFO, ControlStatement *ifStmt)
         : IBlockStatement(INFO)
     {
@@ -112,6 +277,21 @@ namespace up
     {
         string s;
 
+        if (switchVar)
+        {
+            s += "switch (" + switchVar->toString() + ") {\n";
+
+            for (auto c : controls)
+                if (auto control = dynamic_cast<ControlStatement*>(c))
+                    s += control->toCaseString();
+                else
+                    s += ((OrStatement*) c)->toDefaultString();
+
+            s += "}\n";
+
+            return s;
+        }
+
         for (auto c : controls)
             s += c->toString();
 
@@ -120,6 +300,35 @@ namespace up
         return s;
     }
 
+    bool ConditionSequence::isSwitchable() const
+    {
+        // Case values
+        set<long long> values;
+
+        for (auto s : controls)
+        {
+            // The or is the default case
+            auto control = dynamic_cast<ControlStatement*>(s);
+            if (!control)
+                continue;
+
+            VariableUsage *variable;
+            Literal *value = control->caseValue(variable);
+            if (!value)
+                return false;
+
+            // Always the same variable
+            if (variable->toString() != switchVar->toString())
+                return false;
+
+            // Two cases can't have the same value
+            if (!values.insert(stoll(value->data)).second)
+                return false;
+        }
+
+        return values.size() >= MIN_SWITCH_CASES;
+    }
+
     void ConditionSequence::process(Compiler *compiler)
     {
         int i = 0;
@@ -133,12 +342,23 @@ namespace up
 
             ++i;
         }
+
+        // The variable of the first condition must be used by all conditions
+        switchVar = nullptr;
+        VariableUsage *variable;
+        if (((ControlStatement*) controls.front())->caseValue(variable))
+        {
+            switchVar = variable;
+
+            if (!isSwitchable())
+                switchVar = nullptr;
+        }
     }
 
-    void ConditionSequence::pushDestructor(const std::string &DES)
+    void ConditionSequence::setCleanupExit(const int LABEL)
     {
         for (auto c : controls)
-            ((IBlockStatement*) c)->pushDestructor(DES);
+            ((IBlockStatement*) c)->setCleanupExit(LABEL);
     }
 
     OrStatement::OrStatement(const ErrorInfo &INFO, Block *content)
@@ -147,7 +367,7 @@ namespace up
 
     OrStatement::~OrStatement()
     {
-        delete content;
+        // The content is deleted by IMonoBlockStatement
     }
 
     string OrStatement::toString() const
@@ -155,35 +375,97 @@ namespace up
         return "else " + content->toString();
     }
 
+    string OrStatement::toDefaultString() const
+    {
+        return "default: " + content->toString();
+    }
+
     void OrStatement::process(Compiler *compiler)
     {
         content->process(compiler);
     }
 
     ForStatement *ForStatement::createDefaultInit(const ErrorInfo &INFO, const Id &VAR_ID,
-        Expression *end, Block *content)
+        Expression *end, Block *content, Expression *step)
     {
-        return new ForStatement(INFO, VAR_ID, new Literal(INFO, "0", Id("int")), end, content);
+        auto f = new ForStatement(INFO, VAR_ID, new Literal(INFO, "0", Id("int")), end, content, step);
+        f->defaultBegin = true;
+
+        return f;
     }
 
     ForStatement::ForStatement(const ErrorInfo &INFO, const Id &VAR_ID, Expression *begin,
-        Expression *end, Block *content)
-        : IMonoBlockStatement(INFO, content), varId(VAR_ID), begin(begin), end(end)
+        Expression *end, Block *content, Expression *step)
+        : IMonoBlockStatement(INFO, content), varId(VAR_ID), begin(begin), end(end), step(step)
     {}
 
     ForStatement::~ForStatement()
     {
         delete begin;
         delete end;
+        delete step;
     }
 
     string ForStatement::toString() const
     {
-        string s = "for (int ";
-        s += varId.name() + " = " + begin->toString();
-        s += "; " + varId.name() + " < " + end->toString();
-        s += "; ++" + varId.name();
-        s += ") " + content->toString();
+        const string I = varId.name();
+
+        const string TYPE = cType(iteratorType.toUp());
+
+        // Bounds
+        string bounds = "_upEnd = " + end->toString();
+
+        // Literal steps are not stored
+        string stepValue;
+        if (!step)
+            stepValue = "_upStep";
+        else if (dynamic_cast<Literal*>(step))
+            stepValue = step->toString();
+        else
+        {
+            bounds += ", _upStep = " + step->toString();
+            stepValue = "_upStep";
+        }
+
+        if (!step && direction == 0)
+            bounds += ", _upStep = " + I + " <= _upEnd ? 1 : -1";
+
+        // Declared before the loop
+        string declarations;
+
+        string s = "for (" + TYPE + " " + I + " = " + begin->toString();
+        if (hints.simd || hints.par)
+            declarations = " " + TYPE + " " + bounds + ";";
+        else
+            s += ", " + bounds;
+
+        // Condition
+        if (direction > 0)
+            s += "; " + I + " < _upEnd; ";
+        else if (direction < 0)
+            s += "; " + I + " > _upEnd; ";
+        else
+            s += "; _upStep > 0 ? " + I + " < _upEnd : " + I + " > _upEnd; ";
+
+        // Increment
+        if (!step && direction > 0)
+            s += "++" + I;
+        else if (!step && direction < 0)
+            s += "--" + I;
+        else
+            s += I + " += " + stepValue;
+
+        s = hints.toString() + s + ") " + content->toString();
+
+        // The elements are accessed only with these pointers within the loop
+        for (auto v : objects.restricted)
+        {
+            const string NAME = v->id.toC();
+            declarations += " __typeof__(" + NAME + "->data) restrict _upData_" + NAME + " = " + NAME + "->data;";
+        }
+
+        if (!declarations.empty())
+            s = "{" + declarations + "\n\t" + s + "}";
 
         return s;
     }
@@ -198,29 +480,171 @@ namespace up
             return;
         }
 
-        // TODO : Update target type with num support
-        string targetType = "int";
+        // The types are known after the process
+        begin->process(compiler);
+        end->process(compiler);
+        if (step)
+            step->process(compiler);
+
+        // Iterate on floats if a bound or the step is a num
+        iteratorType = Id(begin->type == "num" || end->type == "num" ||
+            (step && step->type == "num") ? "num" : "int");
+        const string TARGET_TYPE = iteratorType.toUp();
+
+        // The int literals are num literals
+        // for x=0 to 1. step 0.25
+        if (iteratorType == "num")
+            for (auto e : { begin, end, step })
+                if (auto literal = dynamic_cast<Literal*>(e); literal && literal->type == "int")
+                {
+                    literal->data += ".";
+                    literal->type = iteratorType;
+                }
 
         // Add the variable to the content's scope
-        content->vars.push_back(new Variable(varId, targetType));
+        Variable *iterator = new Variable(varId, iteratorType);
+        content->vars.push_back(iterator);
 
-        if (!begin->compatibleType(targetType))
+        if (!begin->compatibleType(TARGET_TYPE))
         {
             compiler->generateError("The begin expression of the for statement must have '" +
-                AS_BLUE(targetType) + "' type but has '" + AS_BLUE(begin->type.toUp()) + "' type", info);
+                AS_BLUE(TARGET_TYPE) + "' type but has '" + AS_BLUE(begin->type.toUp()) + "' type", info);
             return;
         }
 
-        if (!end->compatibleType(targetType))
+        if (!end->compatibleType(TARGET_TYPE))
         {
             compiler->generateError("The end expression of the for statement must have '" +
-                AS_BLUE(targetType) + "' type but has '" + AS_BLUE(end->type.toUp()) + "' type", info);
+                AS_BLUE(TARGET_TYPE) + "' type but has '" + AS_BLUE(end->type.toUp()) + "' type", info);
             return;
         }
 
-        begin->process(compiler);
-        end->process(compiler);
-        content->process(compiler);
+        if (step && !step->compatibleType(TARGET_TYPE))
+        {
+            compiler->generateError("The step of the for statement must have '" +
+                AS_BLUE(TARGET_TYPE) + "' type but has '" + AS_BLUE(step->type.toUp()) + "' type", info);
+            return;
+        }
+
+        // Find the direction at compile time if possible
+        auto literalBegin = dynamic_cast<Literal*>(begin);
+        auto literalEnd = dynamic_cast<Literal*>(end);
+        auto literalStep = dynamic_cast<Literal*>(step);
+
+        direction = 0;
+        if (literalStep)
+        {
+            const double STEP = stod(literalStep->data);
+
+            if (STEP == 0)
+            {
+                compiler->generateError("The step of the for statement can't be 0", info);
+                return;
+            }
+
+            direction = STEP > 0 ? 1 : -1;
+        }
+        // from 0 to end
+        else if (!step && defaultBegin)
+            direction = 1;
+        else if (!step && literalBegin && literalEnd)
+            direction = stod(literalBegin->data) <= stod(literalEnd->data) ? 1 : -1;
+
+        // The iterator is within the bounds of the object
+        // for i=b to a.size() with b >= 0
+        Variable *object = nullptr;
+        auto sizeCall = dynamic_cast<Call*>(end);
+        if (iteratorType == "int" && direction > 0 && literalBegin && stoi(literalBegin->data) >= 0 &&
+            sizeCall && sizeCall->function && sizeCall->id.ids.size() == 2 && sizeCall->id.ids[1] == "size" &&
+            sizeCall->args.size() == 1)
+            if (auto usage = dynamic_cast<VariableUsage*>(sizeCall->args[0]))
+                object = compiler->getVar(usage->id);
+
+        // Canonical form of OpenMP
+        const bool OPENMP = hints.simd || hints.par;
+        const string KIND = hints.par ? "par" : "simd";
+
+        if (OPENMP && iteratorType != "int")
+        {
+            compiler->generateError("The iterator of a " + AS_BLUE(KIND) + " loop must have '" +
+                AS_BLUE("int") + "' type but has '" + AS_BLUE(TARGET_TYPE) + "' type", info);
+            return;
+        }
+
+        // The condition is i < end or i > end
+        if (OPENMP && direction == 0)
+        {
+            compiler->generateError("The direction of a " + AS_BLUE(KIND) +
+                " loop must be known at compile time (literal step)", info);
+            return;
+        }
+
+        // Reductions are declared before the loop
+        SharedScope shared = { compiler->scopes.size(), iterator, {}, {} };
+        for (auto &r : hints.reductions)
+        {
+            Variable *v = compiler->getVar(r.id);
+
+            if (!v || (v->type != "int" && v->type != "num"))
+            {
+                compiler->generateError("The reduction '" + AS_BLUE(r.id.toUp()) + "' must be an '" +
+                    AS_BLUE("int") + "' or a '" + AS_BLUE("num") + "' variable declared before the loop", info);
+                return;
+            }
+
+            shared.reductions.push_back(v);
+        }
+
+        if (hints.par)
+            compiler->sharedScopes.push_back(shared);
+
+        // The writes of the iterator are recorded for OpenMP loops
+        if (object || OPENMP)
+            compiler->loopRanges.push_back({ iterator, object, {}, false, false });
+
+        // Usages of the objects (restrict pointers)
+        objects.scopeDepth = compiler->scopes.size();
+        compiler->usageScopes.push_back(&objects);
+        compiler->processedUsages.push_back(&objects);
+
+        processLoop(compiler);
+
+        compiler->usageScopes.pop_back();
+
+        // The threads would write the same variables
+        if (hints.par)
+        {
+            for (auto v : compiler->sharedScopes.back().writes)
+                if (v->count > 0)
+                    compiler->generateError("The table '" + AS_BLUE(v->id.toUp()) + "' is shared by the threads of the " +
+                        AS_BLUE("par") + " loop, only the element of the iteration can be modified within the loop (" +
+                        AS_BLUE(v->id.toUp() + "[" + iterator->id.toUp() + "]") + ")", info);
+                else
+                    compiler->generateError("The variable '" + AS_BLUE(v->id.toUp()) + "' is shared by the threads of the " +
+                        AS_BLUE("par") + " loop, it can't be modified within the loop (except as a reduction, " +
+                        AS_BLUE("reduce(+: " + v->id.toUp() + ")") + ")", info);
+
+            compiler->sharedScopes.pop_back();
+        }
+
+        if (!object && !OPENMP)
+            return;
+
+        // The accesses are unchecked if nothing changes the range
+        LoopRange range = compiler->loopRanges.back();
+        compiler->loopRanges.pop_back();
+
+        if (range.iteratorModified && OPENMP)
+            compiler->generateError("The iterator of a " + AS_BLUE(KIND) + " loop can't be modified within the loop", info);
+
+        if (range.modified)
+            return;
+
+        for (auto [call, unchecked] : range.accesses)
+        {
+            call->function = unchecked;
+            call->unchecked = true;
+        }
     }
 
     string Literal::toString() const
@@ -239,6 +663,11 @@ namespace up
         return data;
     }
 
+    Id VariableUsage::typeName(Compiler *compiler) const
+    {
+        return id.isSimple() ? id : Id();
+    }
+
     string VariableUsage::toString() const
     {
         // TODO : Better mangling
@@ -249,117 +678,392 @@ namespace up
     {
         // Check exists
         if (Variable *v = compiler->getVar(id))
+        {
             // Retrieve type
             type = v->type;
+
+            if (v->count > 0)
+                compiler->generateError("The table '" + AS_BLUE(id.toUp()) +
+                    "' must be used with an index (" + AS_BLUE(id.toUp() + "[i]") + ")", info);
+
+            compiler->checkFuture(v, info);
+
+            if (!borrowed)
+            {
+                v->escapes = true;
+                compiler->recordUsage(v);
+            }
+        }
         else
             // Error
             compiler->generateError("The variable named '" + AS_BLUE(id.toUp()) + "' is not declared in this scope", info);
     }
 
-    Call::~Call()
+    Index::Index(const ErrorInfo &INFO, const Id &ID, Expression *index)
+        : Expression(INFO, Id::createAuto()), id(ID), index(index)
+    {}
+
+    Index::~Index()
     {
-        for (auto a : args)
-            delete a;
+        delete index;
     }
 
-    string Call::toString() const
+    string Index::toString() const
     {
-        // TODO : Better mangling
-        string s = id.toC();
-
-        s += "(";
-
-        if (!args.empty())
-        {
-            s += args[0]->toString();
-
-            for (size_t i = 1; i < args.size(); ++i)
-                s += ", " + args[i]->toString();
-        }
-
-        s += ")";
-
-        return s;
+        return id.toC() + "[" + index->toString() + "]";
     }
 
-    void Call::process(Compiler *compiler)
+    void Index::process(Compiler *compiler)
     {
-        std::string funType;
+        index->process(compiler);
 
-        // Check if it's a constructor
-        if (id.isSimple())
-        {
-            if (typeExists(id))
-            {
-                funType = "constructor";
+        Variable *v = compiler->getVar(id);
 
-                // Change id
-                id.ids.push_back("new");
-            }
-            else
-                funType = "function";
-        }
-        // Check variable exists
-        else if (auto var = compiler->getVar(id.ids[0]))
+        if (!v)
         {
-            funType = "method";
-
-            // Add the variable as argument
-            auto varExpr = new VariableUsage(info, var->id);
-            varExpr->process(compiler);
-            args.insert(args.begin(), { varExpr });
-
-            // Change id
-            id.ids[0] = var->type.name();
+            compiler->generateError("The table named '" + AS_BLUE(id.toUp()) + "' is not declared in this scope", info);
+            return;
         }
-        else if (!isDestructor)
+
+        if (v->count == 0)
         {
-            compiler->generateError("The function '" + AS_BLUE(id.toUp()) +
-                "' is invalid", info);
+            compiler->generateError("The variable '" + AS_BLUE(id.toUp()) + "' is not a table", info);
+            return;
         }
 
-        // Process args
-        for (auto a : args)
-            a->process(compiler);
+        if (index->type != "int")
+            compiler->generateError("The index of the table '" + AS_BLUE(id.toUp()) + "' must be an '" +
+                AS_BLUE("int") + "' (not '" + AS_BLUE(index->type.toUp()) + "')", info);
 
-        // Check the function exists
-        Function *func = compiler->getFunction(id, typeArgList(args));
+        type = v->type;
+        count = v->count;
 
-        // Error : No function found
-        if (!func)
-        {
-            // Stringify args
-            string strArgs = args.size() == 0 ? "" : args[0]->type.toUp();
-            for (size_t i = 1; i < args.size(); ++i)
-                strArgs += ", " + args[i]->type.toUp();
+        // The evaluation of constants checks their own indices
+        if (compiler->currentFunction && Interpreter::isConstant(compiler, index))
+            compiler->constantIndices.push_back(this);
+    }
 
-            compiler->generateError("The " + funType + " '" + AS_BLUE(id.toUp() + "(" + strArgs + ")") +
-                + "' doesn't match any other " + funType +
-                ", verify the name or the arguments", info);
- 
+    void Index::checkBounds(Compiler *compiler)
+    {
+        Interpreter interpreter(compiler);
+        Value i;
+
+        if (!interpreter.evaluate(index, {}, i))
             return;
-        }
 
-        // Update the return type
-        type = func->type;
+        if (i.i < 0 || i.i >= count)
+            compiler->generateError("The index " + to_string(i.i) + " is out of the table '" +
+                AS_BLUE(id.toUp()) + "' (" + to_string(count) + " values)", info);
+    }
+
+    Id Index::typeName(Compiler *compiler) const
+    {
+        TypeName t = compiler->genericType(id, { index }, info);
+
+        // Tables are not types of arguments
+        return t.count == 0 ? t.id : Id();
     }
 
-    VariableDeclaration::VariableDeclaration(const ErrorInfo &INFO, const Id &ID, const Id &TYPE, Expression *expr)
-        : Statement(INFO), id(ID), type(TYPE), expr(expr)
+    FieldUsage::FieldUsage(const ErrorInfo &INFO, Expression *object, const string &FIELD, Expression *index)
+        : Expression(INFO, Id::createAuto()), object(object), field(FIELD), index(index)
     {}
 
-    VariableDeclaration::~VariableDeclaration()
+    FieldUsage::~FieldUsage()
     {
-        if (expr)
-            delete expr;
+        delete object;
+        delete index;
     }
 
-    string VariableDeclaration::toString() const
+    string FieldUsage::toString() const
     {
-        // TODO : Better mangling (*2)
-        if (expr)
-            return parsedType + " " + id.toC() + " = " + expr->toString() + ";";
-        else
+        if (index)
+            return object->toString() + "->" + field + "[" + index->toString() + "]";
+
+        return object->toString() + "->" + field;
+    }
+
+    void FieldUsage::process(Compiler *compiler)
+    {
+        if (auto v = dynamic_cast<VariableUsage*>(object))
+            v->borrowed = true;
+
+        object->process(compiler);
+
+        if (index)
+            index->process(compiler);
+
+        // Error already generated
+        if (object->type == "auto")
+            return;
+
+        const TypeDecl *layout = layoutOf(object->type);
+        const bool COLLECTION = layout && !layout->soaOf.ids.empty();
+
+        if (index && !COLLECTION)
+        {
+            compiler->generateError("The type '" + AS_BLUE(object->type.toUp()) +
+                "' is not a collection with the soa layout", info);
+            return;
+        }
+
+        if (!index && COLLECTION)
+        {
+            compiler->generateError("The field '" + AS_BLUE(field) + "' of the collection '" +
+                AS_BLUE(object->type.toUp()) + "' must be used with an index (" +
+                AS_BLUE("[i]." + field) + ")", info);
+            return;
+        }
+
+        if (index && index->type != "int")
+        {
+            compiler->generateError("The index of the collection '" + AS_BLUE(object->type.toUp()) +
+                "' must be an '" + AS_BLUE("int") + "' (not '" + AS_BLUE(index->type.toUp()) + "')", info);
+            return;
+        }
+
+        // Fields of the elements
+        const Id OWNER = COLLECTION ? layout->soaOf : object->type;
+        if (COLLECTION)
+            layout = layoutOf(OWNER);
+
+        const Field *f = layout ? layout->getField(field) : nullptr;
+
+        if (!f)
+        {
+            compiler->generateError("The type '" + AS_BLUE(OWNER.toUp()) +
+                "' has no field named '" + AS_BLUE(field) + "'", info);
+            return;
+        }
+
+        type = f->type;
+    }
+
+    Call::~Call()
+    {
+        for (auto a : args)
+            delete a;
+    }
+
+    string Call::toString() const
+    {
+        // Result of a previous call
+        if (!cseName.empty() && !cseDefines)
+            return cseName;
+
+        // Element of the object through a restrict pointer
+        if (!dataPointer.empty())
+        {
+            string element = dataPointer + "[" + args[1]->toString() + "]";
+            if (args.size() == 3)
+                element = "(" + element + " = " + args[2]->toString() + ")";
+
+            return cseDefines ? "(" + cseName + " = " + element + ")" : element;
+        }
+
+        // TODO : Better mangling
+        string s = unchecked ? function->cName() : id.toC();
+
+        // The literal arguments are within the copy
+        vector<string> values(args.size());
+        if (!bound.empty())
+        {
+            s = ((UpFunction*) function)->specializationName(bound);
+            values = bound;
+        }
+
+        s += "(";
+
+        bool first = true;
+        for (size_t i = 0; i < args.size(); ++i)
+            if (values[i].empty())
+            {
+                s += (first ? "" : ", ") + args[i]->toString();
+                first = false;
+            }
+
+        s += ")";
+
+        // The result is reused by the next statements
+        if (cseDefines)
+            s = "(" + cseName + " = " + s + ")";
+
+        return s;
+    }
+
+    bool Call::isReusable() const
+    {
+        if (!function || function->purity == Purity::Impure || function->type == "nil")
+            return false;
+
+        // The arguments must not have side effects
+        for (auto a : args)
+            if (!dynamic_cast<VariableUsage*>(a) && !dynamic_cast<Literal*>(a))
+                return false;
+
+        return true;
+    }
+
+    void Call::process(Compiler *compiler)
+    {
+        std::string funType;
+
+        // The variable of a method call
+        Variable *object = nullptr;
+
+        // Check if it's a constructor
+        if (id.isSimple())
+        {
+            if (typeExists(id))
+            {
+                funType = "constructor";
+
+                // Change id
+                id.ids.push_back("new");
+            }
+            else
+                funType = "function";
+        }
+        // Check variable exists
+        else if (auto var = compiler->getVar(id.ids[0]))
+        {
+            funType = "method";
+            object = var;
+
+            // Add the variable as argument
+            auto varExpr = new VariableUsage(info, var->id);
+            varExpr->borrowed = true;
+            varExpr->process(compiler);
+            args.insert(args.begin(), { varExpr });
+
+            // Change id
+            id.ids[0] = var->type.name();
+        }
+        else if (!isDestructor)
+        {
+            compiler->generateError("The function '" + AS_BLUE(id.toUp()) +
+                "' is invalid", info);
+        }
+
+        // Process args
+        for (auto a : args)
+            a->process(compiler);
+
+        // Check the function exists
+        Function *func = compiler->getFunction(id, typeArgList(args));
+
+        // Error : No function found
+        if (!func)
+        {
+            // Stringify args
+            string strArgs = args.size() == 0 ? "" : args[0]->type.toUp();
+            for (size_t i = 1; i < args.size(); ++i)
+                strArgs += ", " + args[i]->type.toUp();
+
+            compiler->generateError("The " + funType + " '" + AS_BLUE(id.toUp() + "(" + strArgs + ")") +
+                + "' doesn't match any other " + funType +
+                ", verify the name or the arguments", info);
+ 
+            return;
+        }
+
+        // A noalias argument must not be the object of another argument
+        if (!func->isMethod)
+            for (size_t i = 0; i < args.size() && i < func->args.size(); ++i)
+                for (size_t j = i + 1; j < args.size() && j < func->args.size(); ++j)
+                    if ((func->args[i]->noalias || func->args[j]->noalias) &&
+                        dynamic_cast<VariableUsage*>(args[i]) && dynamic_cast<VariableUsage*>(args[j]) &&
+                        args[i]->toString() == args[j]->toString())
+                    {
+                        compiler->generateError("The object '" + AS_BLUE(args[i]->toString()) +
+                            "' is passed to the arguments '" + AS_BLUE(func->args[i]->id.toUp()) + "' and '" +
+                            AS_BLUE(func->args[j]->id.toUp()) + "' of the function '" + AS_BLUE(func->id.toUp()) +
+                            "' (one of them is " + AS_BLUE("noalias") + ")", info);
+                        return;
+                    }
+
+        // Parse the body of the function if it has not been parsed
+        if (auto upFunc = dynamic_cast<UpFunction*>(func))
+            compiler->loadBody(upFunc);
+
+        function = func;
+
+        // The check of the index may be removed by a loop
+        // and the object may be accessed with a restrict pointer
+        // * The object of a spawned call is used by another thread
+        if (object)
+        {
+            compiler->checkAccess(this);
+
+            if (spawned)
+                compiler->recordUsage(object);
+            else
+                compiler->recordMethodCall(object, this);
+        }
+
+        // Call a copy of the function with the literal arguments
+        // * Constants are evaluated by the compiler (no copy)
+        bound.clear();
+        if (auto upFunc = dynamic_cast<UpFunction*>(func); upFunc && compiler->currentFunction && !spawned)
+        {
+            bound = upFunc->specialize(args, compiler->maxSpecializations);
+
+            if (!bound.empty())
+                compiler->currentFunction->specializedCalls.push_back({ upFunc, bound });
+        }
+
+        // Call graph (purity inference)
+        if (compiler->currentFunction)
+            compiler->currentFunction->callees.insert(func);
+
+        // Destructor calls are generated after their statement
+        if (!isDestructor && !spawned && !compiler->scopes.empty())
+        {
+            Block *b = compiler->scopes.back();
+            b->callSites.push_back({ b->currentStatement, this });
+        }
+
+        // Update the return type
+        type = func->type;
+    }
+
+    VariableDeclaration::VariableDeclaration(const ErrorInfo &INFO, const Id &ID, const Id &TYPE, Expression *expr,
+        const int COUNT)
+        : Statement(INFO), id(ID), type(TYPE), count(COUNT), expr(expr)
+    {}
+
+    VariableDeclaration::~VariableDeclaration()
+    {
+        if (expr)
+            delete expr;
+    }
+
+    string VariableDeclaration::toString() const
+    {
+        // Table on the stack (initialized to 0)
+        if (count > 0)
+            return parsedType + " " + id.toC() + "[" + to_string(count) + "] = {0};";
+
+        // Storage on the stack and construction in place
+        // For example :
+        // _Array _upStack_a; Array a = &_upStack_a; Array_init(a, 4);
+        if (variable && variable->onStack())
+        {
+            const string NAME = id.toC();
+            const Call *CTOR = (const Call*) expr;
+
+            string init = Id({ type.toUp(), "init" }).toC() + "(" + NAME;
+            for (auto arg : CTOR->args)
+                init += ", " + arg->toString();
+            init += ")";
+
+            return "_" + parsedType + " _upStack_" + NAME + "; " +
+                parsedType + " " + NAME + " = &_upStack_" + NAME + "; " + init + ";";
+        }
+
+        // TODO : Better mangling (*2)
+        if (expr)
+            return parsedType + " " + id.toC() + " = " + expr->toString() + ";";
+        else
             return parsedType + " " + id.toC() + ";";
     }
 
@@ -424,8 +1128,42 @@ namespace up
             return;
         }
 
+        if (count > 0)
+        {
+            if (!isTableType(type))
+            {
+                compiler->generateError("The table '" + AS_BLUE(id.toUp()) + "' must contain '" +
+                    AS_BLUE("int") + "', '" + AS_BLUE("num") + "' or '" + AS_BLUE("bool") + "' values", info);
+                return;
+            }
+
+            if (count > MAX_TABLE_SIZE / typeSize(type))
+            {
+                compiler->generateError("The table '" + AS_BLUE(id.toUp()) + "' is too large for the stack (at most " +
+                    to_string(MAX_TABLE_SIZE) + " bytes), use an " + AS_BLUE("Array"), info);
+                return;
+            }
+        }
+
+        auto ctor = dynamic_cast<Call*>(expr);
+        variable = new Variable(id, type);
+        variable->count = count;
+        recordSource(variable, expr);
+        variable->constructed = ctor && ctor->id.ids.size() == 2 && ctor->id.name() == "new";
+
+        // An object built by a constructor may be constructed in place
+        // if its type provides T.init (same arguments) and T.fini
+        if (variable->constructed)
+        {
+            auto argTypes = typeArgList(ctor->args);
+            argTypes.insert(argTypes.begin(), type.toUp());
+
+            variable->inPlace = compiler->getFunction(Id({ type.toUp(), "init" }), argTypes) &&
+                compiler->getFunction(Id({ type.toUp(), "fini" }));
+        }
+
         // Push the variable in the scope
-        compiler->scopes.back()->vars.push_back(new Variable(id, type));
+        compiler->scopes.back()->vars.push_back(variable);
     }
 
     VariableAssignement::VariableAssignement(const ErrorInfo &INFO, const Id &ID, Expression *expr, const string &OP)
@@ -439,9 +1177,61 @@ namespace up
 
     string VariableAssignement::toString() const
     {
+        if (fused)
+            return fusedString();
+
         return id.toC() + " " + operand + " " + expr->toString() + ";";
     }
 
+    string VariableAssignement::fusedString() const
+    {
+        const string NAME = id.toC();
+
+        string s = "{ ";
+
+        // Scalars
+        map<const Expression*, string> temps;
+        for (auto e : scalars)
+        {
+            const string TEMP = "_upS" + to_string(temps.size());
+
+            s += cType(e->type.toUp()) + " " + TEMP + " = " + e->toString() + "; ";
+            temps[e] = TEMP;
+        }
+
+        // Sizes
+        s += "int _upN = " + sizeFunction + "(" + NAME + "); ";
+
+        string sizeCheck;
+        set<string> checked = { NAME };
+        for (auto a : arrays)
+            if (checked.insert(a->toString()).second)
+                sizeCheck += (sizeCheck.empty() ? "" : " || ") + sizeFunction + "(" + a->toString() + ") != _upN";
+
+        if (!sizeCheck.empty())
+        {
+            // The location is an argument (a % of the path is not a directive)
+            string where;
+            for (char c : expr->info.file.path() + ":" + to_string(expr->info.line))
+                where += c == '"' || c == '\\' ? string("\\") + c : string(1, c);
+
+            // Without headers
+            s += "if (" + sizeCheck + ") { int dprintf(int, const char*, ...); void abort(void); "
+                "dprintf(2, \"%s : The arrays of the element-wise operation have different sizes\\n\", \"" +
+                where + "\"); abort(); } ";
+        }
+
+        // Loop
+        auto op = dynamic_cast<const BinaryOperation*>(expr);
+        string element = op ? op->elementString("_upI", temps) : getter + "(" + expr->toString() + ", _upI)";
+        if (operand != "=")
+            element = "(" + getter + "(" + NAME + ", _upI) " + operand.substr(0, 1) + " " + element + ")";
+
+        s += "\n\tfor (int _upI = 0; _upI < _upN; ++_upI) " + setter + "(" + NAME + ", _upI, " + element + "); }";
+
+        return s;
+    }
+
     void VariableAssignement::process(Compiler *compiler)
     {
         // Check simple id
@@ -462,8 +1252,77 @@ namespace up
             return;
         }
 
+        if (v->isConst)
+        {
+            compiler->generateError("The constant '" + AS_BLUE(id.toUp()) + "' can't be modified", info);
+            return;
+        }
+
+        compiler->checkFuture(v, info);
+
+        // c += a is an element-wise operation (c = c + a), a doesn't escape
+        auto array = operand == "=" ? nullptr : dynamic_cast<VariableUsage*>(expr);
+        if (array)
+        {
+            Variable *a = compiler->getVar(array->id);
+
+            if (a && !compiler->elementType(a->type).empty())
+                array->borrowed = true;
+            else
+                array = nullptr;
+        }
+
         expr->process(compiler);
 
+        // Element-wise operation, the elements of the array are modified
+        auto op = dynamic_cast<BinaryOperation*>(expr);
+        fused = (op && op->elementWise) || array;
+        if (fused)
+        {
+            if (op)
+                compiler->unassignedOperations.erase(op);
+
+            if (!(expr->type == v->type))
+            {
+                compiler->generateError("The type '" + AS_BLUE(v->type.toUp()) + "' of the variable '" +
+                    AS_BLUE(id.toUp()) + "' is not compatible with the type '" + AS_BLUE(expr->type.toUp()) + "'", info);
+                return;
+            }
+
+            checkAssignOperator(compiler, Id(compiler->elementType(v->type)), operand, info);
+
+            const string TYPE = v->type.toUp();
+            sizeFunction = Id({ TYPE, "size" }).toC();
+            getter = Id({ TYPE, "atGetUnchecked" }).toC();
+            setter = Id({ TYPE, "atSetUnchecked" }).toC();
+
+            if (op)
+                op->elementOperands(arrays, scalars);
+            else
+                arrays.push_back(expr);
+
+            // Literals and variables are not evaluated before
+            scalars.erase(remove_if(scalars.begin(), scalars.end(), [](const Expression *e)
+                {
+                    return dynamic_cast<const Literal*>(e) || dynamic_cast<const VariableUsage*>(e);
+                }), scalars.end());
+
+            // The arrays are accessed without restrict pointers
+            compiler->recordUsage(v);
+            for (auto a : arrays)
+                compiler->recordUsage(compiler->getVar(Id(a->toString())));
+
+            compiler->recordWrite(v);
+            if (compiler->currentFunction)
+                compiler->currentFunction->hasSideEffects = true;
+
+            return;
+        }
+
+        // The object may be replaced
+        v->escapes = true;
+        compiler->recordWrite(v);
+
         // Check compatible types
         if (!expr->compatibleType(v->type))
         {
@@ -472,25 +1331,99 @@ namespace up
             return;
         }
 
-        // Check operator declared (or expression operator)
-        if (operand.size() > 1)
-        {
-            const string OP = string(1, operand[0]);
-            if (!operatorExists(expr->type, OP))
-                compiler->generateError("The operator '" + AS_BLUE(operand) +
-                    "' (or '" + AS_BLUE(OP) + "') can't be used with the type '" +
-                    AS_BLUE(expr->type.toUp()) + "'",
-                    info);
-        }
-        else if (!operatorExists(expr->type, operand))
-            compiler->generateError("The operator '" + AS_BLUE(operand) +
-                "' can't be used with the type '" + AS_BLUE(expr->type.toUp()) + "'",
-                info);
+        checkAssignOperator(compiler, expr->type, operand, info);
+
+        if (operand == "=")
+            recordSource(v, expr);
 
         // TODO : Generate function for non builtin types
         // TODO : Generate the good function for +=...
     }
 
+    IndexAssignement::IndexAssignement(const ErrorInfo &INFO, Index *element, Expression *expr, const string &OP)
+        : Statement(INFO), element(element), expr(expr), operand(OP)
+    {}
+
+    IndexAssignement::~IndexAssignement()
+    {
+        delete element;
+        delete expr;
+    }
+
+    string IndexAssignement::toString() const
+    {
+        return element->toString() + " " + operand + " " + expr->toString() + ";";
+    }
+
+    void IndexAssignement::process(Compiler *compiler)
+    {
+        element->process(compiler);
+        expr->process(compiler);
+
+        // Error already generated
+        if (element->type == "auto")
+            return;
+
+        if (compiler->getVar(element->id)->isConst)
+        {
+            compiler->generateError("The constant '" + AS_BLUE(element->id.toUp()) + "' can't be modified", info);
+            return;
+        }
+
+        if (!expr->compatibleType(element->type))
+        {
+            compiler->generateError("The type '" + AS_BLUE(element->type.toUp()) + "' of the table '" +
+                AS_BLUE(element->id.toUp()) + "' is not compatible with the type '" + AS_BLUE(expr->type.toUp()) + "'", info);
+            return;
+        }
+
+        checkAssignOperator(compiler, expr->type, operand, info);
+
+        compiler->recordWrite(compiler->getVar(element->id), false, element->index);
+    }
+
+    FieldAssignement::FieldAssignement(const ErrorInfo &INFO, FieldUsage *field, Expression *expr, const string &OP)
+        : Statement(INFO), field(field), expr(expr), operand(OP)
+    {}
+
+    FieldAssignement::~FieldAssignement()
+    {
+        delete field;
+        delete expr;
+    }
+
+    string FieldAssignement::toString() const
+    {
+        return field->toString() + " " + operand + " " + expr->toString() + ";";
+    }
+
+    void FieldAssignement::process(Compiler *compiler)
+    {
+        field->process(compiler);
+        expr->process(compiler);
+
+        // Error already generated
+        if (field->type == "auto")
+            return;
+
+        if (!expr->compatibleType(field->type))
+        {
+            compiler->generateError("The type '" + AS_BLUE(field->type.toUp()) + "' of the field is not " +
+                "compatible with the type '" + AS_BLUE(expr->type.toUp()) + "'", info);
+            return;
+        }
+
+        checkAssignOperator(compiler, expr->type, operand, info);
+
+        // The memory of the object is modified, calls are not reused
+        // across this statement
+        Block *b = compiler->scopes.back();
+        b->barriers.insert(b->currentStatement);
+
+        if (compiler->currentFunction)
+            compiler->currentFunction->hasSideEffects = true;
+    }
+
     Return::Return(const ErrorInfo &INFO, Expression *expr)
         : Statement(INFO), expr(expr)
     {}
@@ -503,18 +1436,196 @@ namespace up
 
     string Return::toString() const
     {
+        const string SYNC = sync ? "_upSync(&_upFrame); " : "";
+
+        // Nothing to destroy
+        if (cleanupLabel < 0)
+        {
+            const string RET = expr ? "return " + expr->toString() + ";" : "return;";
+
+            return sync ? "{ " + SYNC + RET + " }" : RET;
+        }
+
+        // The value is computed before the cleanups
+        string s = "{ " + SYNC;
+
         if (expr)
-            return "return " + expr->toString() + ";";
-        else
-            return "return;";
+            s += "_upRet = " + expr->toString() + "; ";
+
+        if (setsReturning)
+            s += "_upReturning = 1; ";
+
+        s += "goto _upClean" + to_string(cleanupLabel) + "; }";
+
+        return s;
     }
 
     void Return::process(Compiler *compiler)
     {
         // TODO : Set block type etc...
 
-        if (expr)
-            expr->process(compiler);
+        if (compiler->currentFunction)
+            compiler->currentFunction->returns.push_back(this);
+
+        if (!expr)
+            return;
+
+        expr->process(compiler);
+
+        if (auto call = dynamic_cast<Call*>(expr))
+            returnedCall = call->function;
+        else if (auto usage = dynamic_cast<VariableUsage*>(expr))
+            returnedVar = compiler->getVar(usage->id);
+    }
+
+    Spawn::Spawn(const ErrorInfo &INFO, Call *call, const Id &ID, const Id &TYPE)
+        : Statement(INFO), call(call), id(ID), type(TYPE)
+    {}
+
+    Spawn::~Spawn()
+    {
+        delete call;
+    }
+
+    string Spawn::toString() const
+    {
+        const string TASK = "_UpSpawn_" + name;
+
+        string s;
+        if (future)
+            s += cType(type.toUp()) + " " + id.toC() + "; ";
+
+        s += "{ " + TASK + " *_upT = malloc(sizeof(*_upT)); _upT->task.run = _upRun_" + name + ";";
+
+        if (future)
+            s += " _upT->result = &" + id.toC() + ";";
+
+        for (size_t i = 0; i < call->args.size(); ++i)
+            s += " _upT->a" + to_string(i) + " = " + call->args[i]->toString() + ";";
+
+        s += " _upSpawn(&_upFrame, &_upT->task); }";
+
+        return s;
+    }
+
+    void Spawn::process(Compiler *compiler)
+    {
+        UpFunction *f = compiler->currentFunction;
+        Block *block = compiler->scopes.back();
+
+        if (!f)
+        {
+            compiler->generateError("A call can be spawned only within a function", info);
+            return;
+        }
+
+        f->usesSpawn = true;
+
+        call->spawned = true;
+        call->process(compiler);
+
+        if (!call->function)
+            return;
+
+        // The spawned call may modify anything
+        block->barriers.insert(block->currentStatement);
+        block->spawned = true;
+
+        name = f->cName() + "_" + to_string(f->spawns.size());
+        f->spawns.push_back(this);
+        f->hasSideEffects = true;
+
+        // The result is not used
+        if (id.ids.empty())
+            return;
+
+        if (!id.isSimple())
+        {
+            compiler->generateError("The variable '" +
+                AS_BLUE(id.toUp()) + "' must have a simple id (no prefix)", info);
+            return;
+        }
+
+        if (block->getVar(id))
+        {
+            compiler->generateError("The variable '" + AS_BLUE(id.toUp()) +
+                "' already exists in this scope", info);
+            return;
+        }
+
+        if (call->type == "nil")
+        {
+            compiler->generateError("The spawned function '" + AS_BLUE(call->function->id.toUp()) +
+                "' doesn't return a value (" + AS_BLUE("nil") + ")", info);
+            return;
+        }
+
+        if (type != "auto" && !call->compatibleType(type))
+        {
+            compiler->generateError("Error for variable '" + AS_BLUE(id.toUp()) + "'\n" \
+                "The spawned call of type '" + AS_BLUE(call->type.toUp()) +
+                "' must match the type of the variable\n", info);
+            return;
+        }
+
+        type = call->type;
+
+        // Written by another thread, read after a sync
+        future = new Variable(id, type);
+        future->escapes = true;
+        block->vars.push_back(future);
+        block->sync = true;
+        compiler->futures.insert(future);
+    }
+
+    string Spawn::taskCode() const
+    {
+        const string TASK = "_UpSpawn_" + name;
+
+        // Result and arguments
+        string s = "typedef struct { _UpTask task;";
+
+        if (future)
+            s += " " + cType(type.toUp()) + " *result;";
+
+        for (size_t i = 0; i < call->args.size(); ++i)
+            s += " " + cType(call->args[i]->type.toUp()) + " a" + to_string(i) + ";";
+
+        s += " } " + TASK + ";\n";
+
+        // The function may be defined after
+        if (dynamic_cast<UpFunction*>(call->function))
+            s += call->function->signature() + ";\n";
+
+        string c = (call->unchecked ? call->function->cName() : call->id.toC()) + "(";
+        for (size_t i = 0; i < call->args.size(); ++i)
+            c += (i == 0 ? "t->a" : ", t->a") + to_string(i);
+        c += ")";
+
+        s += "static void _upRun_" + name + "(_UpTask *task) {\n";
+        s += "\t" + TASK + " *t = (" + TASK + "*) task;\n";
+        s += "\t" + string(future ? "*t->result = " : "") + c + ";\n";
+        s += "\tfree(t);\n}\n";
+
+        return s;
+    }
+
+    string Sync::toString() const
+    {
+        return "_upSync(&_upFrame);";
+    }
+
+    void Sync::process(Compiler *compiler)
+    {
+        UpFunction *f = compiler->currentFunction;
+
+        if (!f || f->spawns.empty())
+        {
+            compiler->generateError("There is no spawned call to sync (" + AS_BLUE("spawn f(x)") + ")", info);
+            return;
+        }
+
+        compiler->futures.clear();
     }
 
     UnaryOperation::UnaryOperation(const ErrorInfo &INFO, const Id &ID, const string &OP, const bool PREFIX)
@@ -551,6 +1662,16 @@ namespace up
         // Set type
         type = v->type;
 
+        if (v->isConst)
+        {
+            compiler->generateError("The constant '" + AS_BLUE(id.toUp()) + "' can't be modified", info);
+            return;
+        }
+
+        compiler->checkFuture(v, info);
+
+        compiler->recordWrite(v);
+
         if (!operatorExists(type, operand))
             compiler->generateError("The operator '" + AS_BLUE(operand) +
                 "' can't be used with the type '" + AS_BLUE(type.toUp()) + "'",
@@ -574,10 +1695,112 @@ namespace up
         return first->toString() + " " + operand + " " + second->toString();
     }
 
-    void BinaryOperation::process(Compiler *compiler)
-    {
-        first->process(compiler);
-        second->process(compiler);
+    Literal *BinaryOperation::intEquality(VariableUsage *&variable) const
+    {
+        if (operand != "==" || first->type != "int" || second->type != "int")
+            return nullptr;
+
+        variable = dynamic_cast<VariableUsage*>(first);
+        auto literal = dynamic_cast<Literal*>(second);
+
+        // 42 == a
+        if (!variable)
+        {
+            variable = dynamic_cast<VariableUsage*>(second);
+            literal = dynamic_cast<Literal*>(first);
+        }
+
+        return variable && literal ? literal : nullptr;
+    }
+
+    string BinaryOperation::elementString(const string &I, const map<const Expression*, string> &SCALARS) const
+    {
+        auto element = [&](const Expression *e) -> string
+        {
+            if (auto op = dynamic_cast<const BinaryOperation*>(e); op && op->elementWise)
+                return op->elementString(I, SCALARS);
+
+            // Array
+            if (e->type == type)
+                return getter + "(" + e->toString() + ", " + I + ")";
+
+            auto scalar = SCALARS.find(e);
+
+            return scalar == SCALARS.end() ? e->toString() : scalar->second;
+        };
+
+        return "(" + element(first) + " " + operand + " " + element(second) + ")";
+    }
+
+    void BinaryOperation::elementOperands(vector<const Expression*> &arrays, vector<const Expression*> &scalars) const
+    {
+        for (const Expression *e : { first, second })
+        {
+            if (auto op = dynamic_cast<const BinaryOperation*>(e); op && op->elementWise)
+                op->elementOperands(arrays, scalars);
+            else if (e->type == type)
+                arrays.push_back(e);
+            else
+                scalars.push_back(e);
+        }
+    }
+
+    void BinaryOperation::process(Compiler *compiler)
+    {
+        // Arrays of element-wise operations don't escape
+        for (auto e : { first, second })
+            if (auto usage = dynamic_cast<VariableUsage*>(e))
+                if (Variable *v = compiler->getVar(usage->id); v && !compiler->elementType(v->type).empty())
+                    usage->borrowed = true;
+
+        first->process(compiler);
+        second->process(compiler);
+
+        // Element-wise operation on arrays
+        // * Only the variable which receives the result can use it
+        const string FIRST_ELEMENT = compiler->elementType(first->type);
+        const string SECOND_ELEMENT = compiler->elementType(second->type);
+        if (!FIRST_ELEMENT.empty() || !SECOND_ELEMENT.empty())
+        {
+            const Id ARRAY = FIRST_ELEMENT.empty() ? second->type : first->type;
+            const Id ELEMENT = Id(FIRST_ELEMENT.empty() ? SECOND_ELEMENT : FIRST_ELEMENT);
+
+            type = ARRAY;
+            elementWise = true;
+            getter = Id({ ARRAY.toUp(), "atGetUnchecked" }).toC();
+            compiler->unassignedOperations.insert(this);
+
+            if (condition)
+            {
+                compiler->generateError("The arrays of type '" + AS_BLUE(ARRAY.toUp()) +
+                    "' can't be compared with '" + AS_BLUE(operand) + "'", info);
+                return;
+            }
+
+            for (auto e : { first, second })
+            {
+                auto op = dynamic_cast<BinaryOperation*>(e);
+
+                if (op && op->elementWise)
+                    compiler->unassignedOperations.erase(op);
+                else if (e->type == ARRAY && !dynamic_cast<VariableUsage*>(e))
+                    compiler->generateError("The arrays of an element-wise operation must be variables", e->info);
+                else if (!(e->type == ARRAY) && !e->compatibleType(ELEMENT))
+                    compiler->generateError("Types '" + AS_BLUE(ARRAY.toUp()) + "' and '" + AS_BLUE(e->type.toUp()) +
+                        "' are incompatible for '" + AS_BLUE(operand) + "' operation (the values are '" +
+                        AS_BLUE(ELEMENT.toUp()) + "')", info);
+
+                if (op && op->elementWise && !(op->type == ARRAY))
+                    compiler->generateError("Types '" + AS_BLUE(ARRAY.toUp()) + "' and '" + AS_BLUE(op->type.toUp()) +
+                        "' are incompatible for '" + AS_BLUE(operand) + "' operation", info);
+            }
+
+            if (!operatorExists(ELEMENT, operand))
+                compiler->generateError("The operator '" + AS_BLUE(operand) +
+                    "' can't be used with the type '" + AS_BLUE(ELEMENT.toUp()) + "'", info);
+
+            return;
+        }
 
         // Type compatibility
         if (!first->compatibleType(second->type))
@@ -611,18 +1834,38 @@ namespace up
 
     string Block::toString() const
     {
-        string s = "{\n";
+        string s = "{\n" + cseDeclarations;
 
         // Add statements
         for (auto instr : content)
+            s += "\t" + instr->toString() + "\n";
+
+        if (sync)
+            s += "\t_upSync(&_upFrame);\n";
+
+        // Cleanups in reverse order of declaration
+        for (auto c = cleanups.rbegin(); c != cleanups.rend(); ++c)
         {
-            // Prepend destructors before a return
-            if (dynamic_cast<Return*>(instr))
-                s += destructors;
+            string call = c->var->onStack() ? c->stackCall : c->call;
 
-            s += "\t" + instr->toString() + "\n";
+            // Copies and borrowed results are destroyed by their owner
+            if (!c->owned)
+                call = "";
+
+            // The returned object escapes
+            if (c->mayBeReturned && !call.empty())
+                call = "if (!_upReturning || _upRet != " + c->var->id.toC() + ") " + call;
+
+            // A label must be followed by a statement
+            if (!cleanupJumps || cleanupJumps->count(c->label))
+                s += "_upClean" + to_string(c->label) + ":\n\t" + (call.empty() ? ";" : call) + "\n";
+            else if (!call.empty())
+                s += "\t" + call + "\n";
         }
 
+        if (!cleanups.empty() && !exitStatement.empty())
+            s += "\t" + exitStatement + "\n";
+
         s += "}\n";
 
         return s;
@@ -633,42 +1876,228 @@ namespace up
         // Push scope
         compiler->scopes.push_back(this);
 
+        UpFunction *f = compiler->currentFunction;
+
+        // A sync within this block may not be run (see Spawn)
+        const set<Variable*> FUTURES = compiler->futures;
+
+        // Variables declared before (arguments, iterators) are not destroyed
+        size_t varI = vars.size();
+
         // Process content
-        int varI = 0;
-        for (auto instr : content)
+        for (currentStatement = 0; currentStatement < content.size(); ++currentStatement)
         {
+            Statement *instr = content[currentStatement];
+
+            // Calls are not reused across blocks and C code
+            if (dynamic_cast<IBlockStatement*>(instr) || dynamic_cast<CStatement*>(instr))
+                barriers.insert(currentStatement);
+
+            // Where to go to return from this statement
+            const int CLEANUP = cleanups.empty() ? exitLabel : cleanups.back().label;
+
+            if (auto ret = dynamic_cast<Return*>(instr))
+            {
+                ret->cleanupLabel = CLEANUP;
+
+                if (f && CLEANUP >= 0)
+                    f->cleanupJumps.insert(CLEANUP);
+            }
+            else if (auto b = dynamic_cast<IBlockStatement*>(instr))
+                b->setCleanupExit(CLEANUP);
+
             instr->process(compiler);
 
-            // Add destructors for variable declared before the block
-            if (IBlockStatement *b = dynamic_cast<IBlockStatement*>(instr))
-                // Add destructors
-                b->pushDestructor(destructors);
+            // The result of an element-wise operation is an array
+            for (auto op : compiler->unassignedOperations)
+                compiler->generateError("The element-wise operation must be assigned to an array (" +
+                    AS_BLUE("c = a + b") + ")", op->info);
+            compiler->unassignedOperations.clear();
 
             // Generate destructors for new variables
-            for ( ; varI < vars.size(); ++varI)
+            for ( ; f && varI < vars.size(); ++varI)
             {
-                // Generate destructor id
-                Id id({ vars[varI]->type.toUp(), "del" });
+                Variable *v = vars[varI];
 
-                // If this destructor exists, process it and add it
-                if (auto f = compiler->getFunction(id))
-                {
-                    // Generate the destructor call statement
-                    auto des = new ExpressionStatement(info,
-                        new Call(info, id, { new VariableUsage(info, vars[varI]->id) }, true)
-                    );
+                // Whether it is on the stack is known at the end of the function
+                Cleanup c = { 0, v, cleanupCall(compiler, v, "del"), "", v->type == f->type, true };
+                if (v->inPlace)
+                    c.stackCall = cleanupCall(compiler, v, "fini");
+
+                if (c.call.empty() && c.stackCall.empty())
+                    continue;
+
+                c.label = ++f->cleanupLabels;
+                cleanups.push_back(c);
+            }
+        }
+
+        // Go to the cleanups of the parent block or return
+        // * The body of the function always returns
+        const string IF_RETURNING = compiler->scopes.size() == 1 ? "" : "if (_upReturning) ";
 
-                    des->process(compiler);
+        if (exitLabel >= 0)
+            exitStatement = IF_RETURNING + "goto _upClean" + to_string(exitLabel) + ";";
+        else if (f && f->type != "nil")
+            exitStatement = IF_RETURNING + "return _upRet;";
+        else if (!IF_RETURNING.empty())
+            exitStatement = IF_RETURNING + "return;";
+        else
+            exitStatement = "";
+
+        // The exit statement follows the cleanups
+        if (f && !cleanups.empty())
+        {
+            if (exitLabel >= 0)
+                f->cleanupJumps.insert(exitLabel);
+
+            if (!IF_RETURNING.empty() && !exitStatement.empty())
+                f->checksReturning = true;
+        }
+
+        cleanupJumps = f ? &f->cleanupJumps : nullptr;
+
+        // The spawned calls may use the objects destroyed by this block
+        if (spawned && !cleanups.empty())
+            sync = true;
+
+        compiler->futures = FUTURES;
+        compiler->scopes.pop_back();
+
+        if (spawned && f && f->body != this && !compiler->scopes.empty())
+            compiler->scopes.back()->spawned = true;
+
+        if (f)
+            compiler->processedBlocks.push_back({ this, f });
+    }
+
+    void Block::eliminateCalls(UpFunction *f)
+    {
+        // A call whose result is available
+        struct Result
+        {
+            Call *call;
+            // The arguments which are variables (C names)
+            vector<string> vars;
+        };
+
+        // Results by C call
+        map<string, Result> results;
 
-                    // Stringify the statement
-                    destructors += "\t" + des->toString() + "\n";
+        size_t site = 0;
+        size_t write = 0;
+        for (size_t i = 0; i < content.size(); ++i)
+        {
+            // Results of this statement, available after it
+            // * The evaluation order of C operands is unspecified
+            map<string, Result> newResults;
+            bool impure = false;
+
+            for ( ; site < callSites.size() && callSites[site].statement == i; ++site)
+            {
+                Call *call = callSites[site].call;
+
+                if (!call->function || call->function->purity == Purity::Impure)
+                    impure = true;
+
+                if (barriers.count(i) || !call->isReusable())
+                    continue;
+
+                const string KEY = call->toString();
+                auto result = results.find(KEY);
+
+                // New result
+                if (result == results.end())
+                {
+                    Result r = { call, {} };
+                    for (auto a : call->args)
+                        if (dynamic_cast<VariableUsage*>(a))
+                            r.vars.push_back(a->toString());
 
-                    delete des;
+                    newResults.insert({ KEY, r });
+                    continue;
                 }
+
+                // Store the result of the first call
+                Call *first = result->second.call;
+                if (first->cseName.empty())
+                {
+                    first->cseName = "_upCse" + to_string(f->cseTemps++);
+                    first->cseDefines = true;
+                    cseDeclarations += "\t" + cType(first->type.toUp()) + " " + first->cseName + ";\n";
+                }
+
+                call->cseName = first->cseName;
+            }
+
+            if (barriers.count(i))
+            {
+                results.clear();
+
+                while (write < writes.size() && writes[write].first == i)
+                    ++write;
+
+                continue;
+            }
+
+            results.insert(newResults.begin(), newResults.end());
+
+            // The memory may have been modified
+            if (impure)
+            {
+                for (auto r = results.begin(); r != results.end(); )
+                    if (r->second.call->function->purity != Purity::Const)
+                        r = results.erase(r);
+                    else
+                        ++r;
             }
+
+            // Results which depend on modified variables
+            for ( ; write < writes.size() && writes[write].first == i; ++write)
+                for (auto r = results.begin(); r != results.end(); )
+                {
+                    auto &vars = r->second.vars;
+
+                    if (find(vars.begin(), vars.end(), writes[write].second) != vars.end())
+                        r = results.erase(r);
+                    else
+                        ++r;
+                }
         }
+    }
 
-        compiler->scopes.pop_back();
+    void Block::releaseBorrowed(UpFunction *f)
+    {
+        for (auto &c : cleanups)
+        {
+            c.owned = ownsObject(c.var);
+
+            // The returned object escapes (see toString)
+            if (c.owned && c.mayBeReturned && !(c.var->onStack() ? c.stackCall : c.call).empty())
+                f->checksReturning = true;
+        }
+    }
+
+    string Block::cleanupCall(Compiler *compiler, Variable *v, const string &NAME)
+    {
+        Id id({ v->type.toUp(), NAME });
+
+        if (!compiler->getFunction(id))
+            return "";
+
+        // Generate the call statement
+        auto usage = new VariableUsage(info, v->id);
+        usage->borrowed = true;
+
+        auto des = new ExpressionStatement(info, new Call(info, id, { usage }, true));
+        des->process(compiler);
+
+        // Stringify the statement
+        string s = des->toString();
+
+        delete des;
+
+        return s;
     }
 
     Variable *Block::getVar(const Id &ID)
@@ -685,13 +2114,157 @@ namespace up
         content.push_back(s);
     }
 
+    void Block::recordWrite(const string &NAME)
+    {
+        writes.push_back({ currentStatement, NAME });
+    }
+
+    Constant::Constant(const ErrorInfo &INFO, const Id &TYPE, const Id &ID, Expression *expr,
+        const int COUNT, const Id &INDEX)
+        : ISyntax(INFO), variable(ID, TYPE), expr(expr), index(INDEX), scope(nullptr)
+    {
+        variable.count = COUNT;
+        variable.isConst = true;
+
+        // Precompiled
+        if (!expr)
+            processed = evaluated = true;
+    }
+
+    Constant::~Constant()
+    {
+        if (expr)
+            delete expr;
+
+        if (scope)
+            delete scope;
+    }
+
+    string Constant::toString() const
+    {
+        const string TYPE = cType(variable.type.toUp()) + " " + variable.id.toC();
+
+        if (variable.count == 0)
+            return "static const " + TYPE + " = " + values[0] + ";\n";
+
+        string s = "static const " + TYPE + "[" + to_string(variable.count) + "] = {";
+        for (size_t i = 0; i < values.size(); ++i)
+            s += (i % 8 == 0 ? "\n\t" : " ") + values[i] + (i + 1 < values.size() ? "," : "");
+
+        return s + "\n};\n";
+    }
+
+    void Constant::process(Compiler *compiler)
+    {
+        processed = true;
+
+        const Id &TYPE = variable.type;
+        if (TYPE != "int" && TYPE != "num" && TYPE != "bool")
+        {
+            compiler->generateError("The constant '" + AS_BLUE(variable.id.toUp()) + "' must be an '" +
+                AS_BLUE("int") + "', a '" + AS_BLUE("num") + "' or a '" + AS_BLUE("bool") + "'", info);
+            return;
+        }
+
+        if (variable.count < 0 || (variable.count == 0 && !index.ids.empty()))
+        {
+            compiler->generateError("The table '" + AS_BLUE(variable.id.toUp()) +
+                "' must contain at least one value", info);
+            return;
+        }
+
+        // The index is a num in num tables (no implicit cast)
+        scope = new Block(info);
+        if (variable.count > 0)
+            scope->vars.push_back(new Variable(index, TYPE == "num" ? Id("num") : Id("int")));
+
+        // Functions are not called from a function
+        auto callerScopes = compiler->scopes;
+        auto callerFunction = compiler->currentFunction;
+        compiler->scopes = { scope };
+        compiler->currentFunction = nullptr;
+
+        expr->process(compiler);
+
+        compiler->scopes = callerScopes;
+        compiler->currentFunction = callerFunction;
+
+        if (!expr->compatibleType(TYPE))
+            compiler->generateError("The type '" + AS_BLUE(TYPE.toUp()) + "' of the constant '" +
+                AS_BLUE(variable.id.toUp()) + "' is not compatible with the type '" +
+                AS_BLUE(expr->type.toUp()) + "'", info);
+    }
+
+    bool Constant::evaluate(Compiler *compiler)
+    {
+        if (evaluated)
+            return true;
+
+        if (evaluating)
+        {
+            compiler->generateError("The constant '" + AS_BLUE(variable.id.toUp()) + "' depends on itself", info);
+            return false;
+        }
+
+        // A constant used by the size of a table is evaluated while parsing
+        if (!processed)
+        {
+            const size_t ERRORS = compiler->diagnostics.size();
+            process(compiler);
+
+            if (compiler->diagnostics.size() != ERRORS)
+                return false;
+        }
+
+        evaluating = true;
+
+        Interpreter interpreter(compiler);
+        const int COUNT = variable.count == 0 ? 1 : variable.count;
+        const Id INDEX_TYPE = scope && !scope->vars.empty() ? scope->vars[0]->type : Id("int");
+
+        values.clear();
+        for (int i = 0; i < COUNT; ++i)
+        {
+            map<string, Value> vars;
+            if (variable.count > 0)
+            {
+                Value v;
+                v.type = Id("int");
+                v.i = i;
+                vars[index.toC()] = v.to(INDEX_TYPE);
+            }
+
+            Value result;
+            if (!interpreter.evaluate(expr, vars, result))
+                break;
+
+            const string LITERAL = result.to(variable.type).toC();
+            if (LITERAL.empty())
+            {
+                compiler->generateError("The value " + (variable.count > 0 ? to_string(i) + " " : "") +
+                    "of the constant '" + AS_BLUE(variable.id.toUp()) + "' is not a finite number", info);
+                break;
+            }
+
+            values.push_back(LITERAL);
+        }
+
+        evaluating = false;
+        evaluated = values.size() == (size_t) COUNT;
+
+        if (!evaluated)
+            values.clear();
+
+        return evaluated;
+    }
+
     Argument *Argument::createEllipsis(const ErrorInfo &INFO)
     {
         return new Argument(INFO, Id::createEllipsis(), Id::createEllipsis());
     }
 
-    Argument::Argument(const ErrorInfo &INFO, const Id &TYPE, const Id &ID)
-        : ISyntax(INFO), type(TYPE), id(ID)
+    Argument::Argument(const ErrorInfo &INFO, const Id &TYPE, const Id &ID, const bool NOALIAS)
+        : ISyntax(INFO), type(TYPE), id(ID), noalias(NOALIAS)
     {}
 
     string Argument::toString() const
@@ -719,6 +2292,10 @@ namespace up
         if (!type.isSimple())
             compiler->generateError("The type '" + AS_BLUE(type.toUp()) + "' of the variable '" +
                 AS_BLUE(id.toUp()) + "' must have a simple id (no prefix)", info);
+
+        if (noalias && (type == "int" || type == "num" || type == "bool" || type == "str"))
+            compiler->generateError("The argument '" + AS_BLUE(id.toUp()) + "' can't be " +
+                AS_BLUE("noalias") + " (only objects can be)", info);
     }
 
     bool Argument::operator==(const Argument &ARG) const
@@ -740,6 +2317,9 @@ namespace up
 
             if (ID.name() != "new")
                 f->isMethod = true;
+
+            // An element or a field of the object (Array.atGet)
+            f->borrows = !(TYPE == Id(ID.ids[0]));
         }
 
         return f;
@@ -757,6 +2337,9 @@ namespace up
 
     void Function::process(Compiler *compiler)
     {
+        // The purity of up functions is inferred later
+        purity = modifiers.purity;
+
         // Special functions
         if (isMethod)
         {
@@ -792,10 +2375,10 @@ namespace up
             arg->process(compiler);
     }
 
-    string Function::signature() const
+    string Function::signature(const string &NAME) const
     {
         // TODO : cType
-        string s = cType(type.toUp()) + " " + cName() + "(";
+        string s = cType(type.toUp()) + " " + (NAME.empty() ? cName() : NAME) + "(";
 
         if (!args.empty())
         {
@@ -809,6 +2392,23 @@ namespace up
         return s;
     }
 
+    string Function::attribute() const
+    {
+        // gcc ignores the purity of functions without result
+        if (type == "nil")
+            return "";
+
+        // * The inferred purity is not emitted, gcc infers it
+        //   too and knows whether the function may not return
+        if (modifiers.purity == Purity::Const)
+            return "__attribute__((const))";
+
+        if (modifiers.purity == Purity::Pure)
+            return "__attribute__((pure))";
+
+        return "";
+    }
+
     bool Function::operator==(const Function &OTHER) const
     {
         // TODO : Add type check also when function overloading
@@ -833,15 +2433,258 @@ namespace up
     UpFunction::~UpFunction()
     {
         delete body;
+        delete lazyBody;
+    }
+
+    bool UpFunction::returnsBorrowed()
+    {
+        // A recursive call returns what the other returns return
+        if (borrows || checkingReturns)
+            return borrows;
+
+        checkingReturns = true;
+
+        bool borrowed = false;
+        for (auto r : returns)
+            if (r->returnedCall ? r->returnedCall->returnsBorrowed() :
+                !r->returnedVar || !ownsObject(r->returnedVar))
+            {
+                borrowed = true;
+                break;
+            }
+
+        checkingReturns = false;
+
+        return borrowed;
     }
 
     string UpFunction::toString() const
     {
         // Signature
-        string s = signature() + " ";
+        const string ATTRIBUTE = attribute();
+        string s = (ATTRIBUTE.empty() ? "" : ATTRIBUTE + " ") + signature() + " ";
 
         // Content
-        s += body->toString();
+        string content = body->toString();
+
+        // Variables of the returns with cleanups
+        if (cleanupLabels > 0)
+        {
+            string returnVars = checksReturning ? "\tint _upReturning = 0;\n" : "";
+
+            if (type != "nil")
+                returnVars += "\t" + cType(type.toUp()) + " _upRet;\n";
+
+            // After {\n
+            content.insert(2, returnVars);
+        }
+
+        // Pending tasks of this call, the scheduler and the tasks are
+        // declared before the function
+        string tasks;
+        if (!spawns.empty())
+        {
+            content.insert(2, "\t_UpFrame _upFrame = { 0 };\n");
+
+            tasks = SPAWN_RUNTIME;
+            for (auto sp : spawns)
+                tasks += sp->taskCode();
+        }
+
+        if (modifiers.memo)
+            return tasks + memoize(ATTRIBUTE, content);
+
+        // The body is within a function whose restrict arguments
+        // are the elements of the noalias arguments
+        string inner;
+        if (!objects.restricted.empty())
+        {
+            const string INNER = "_upNoalias_" + cName();
+
+            string innerArgs, values;
+            for (auto a : args)
+            {
+                innerArgs += (innerArgs.empty() ? "" : ", ") + a->toString();
+                values += (values.empty() ? "" : ", ") + a->id.toC();
+            }
+
+            for (auto v : objects.restricted)
+            {
+                const string NAME = v->id.toC();
+
+                innerArgs += ", __typeof__(((" + cType(v->type.toUp()) + ") 0)->data) restrict _upData_" + NAME;
+                values += ", " + NAME + "->data";
+            }
+
+            inner = "static inline __attribute__((always_inline)) " + cType(type.toUp()) + " " +
+                INNER + "(" + innerArgs + ") " + content + "\n";
+            content = "{\n\t" + string(type == "nil" ? "" : "return ") + INNER + "(" + values + ");\n}\n";
+        }
+
+        s += content;
+
+        // Copies are declared before since this function may call them
+        string prototypes;
+        for (size_t i = 0; i < specializations.size(); ++i)
+        {
+            const string COPY = specializationString(i, ATTRIBUTE, content);
+
+            prototypes += COPY.substr(0, COPY.find(" {\n")) + ";\n";
+            s += "\n" + COPY;
+        }
+
+        return tasks + inner + prototypes + s;
+    }
+
+    vector<string> UpFunction::specialize(const vector<Expression*> &ARGS, const int MAX)
+    {
+        // A memo function must use its cache
+        if (modifiers.memo || ARGS.size() != args.size())
+            return {};
+
+        vector<string> values(ARGS.size());
+        bool bound = false;
+        for (size_t i = 0; i < ARGS.size(); ++i)
+        {
+            auto literal = dynamic_cast<Literal*>(ARGS[i]);
+
+            if (literal && literal->type != "str" && literal->type == args[i]->type)
+            {
+                values[i] = literal->toString();
+                bound = true;
+            }
+        }
+
+        if (!bound)
+            return {};
+
+        auto found = find(specializations.begin(), specializations.end(), values);
+        if (found == specializations.end() && (int) specializations.size() >= MAX)
+            return {};
+
+        addSpecialization(values);
+
+        return values;
+    }
+
+    void UpFunction::addSpecialization(const vector<string> &VALUES)
+    {
+        if (find(specializations.begin(), specializations.end(), VALUES) == specializations.end())
+            specializations.push_back(VALUES);
+    }
+
+    string UpFunction::specializationName(const vector<string> &VALUES) const
+    {
+        const int I = find(specializations.begin(), specializations.end(), VALUES) - specializations.begin();
+
+        return "_upSpec" + to_string(I) + "_" + cName();
+    }
+
+    string UpFunction::specializationString(const int I, const string &ATTRIBUTE, const string &BODY) const
+    {
+        const vector<string> &VALUES = specializations[I];
+
+        // Arguments which are not bound
+        string s = "static " + (ATTRIBUTE.empty() ? "" : ATTRIBUTE + " ") +
+            cType(type.toUp()) + " " + specializationName(VALUES) + "(";
+
+        bool first = true;
+        string constants;
+        for (size_t i = 0; i < args.size(); ++i)
+            if (VALUES[i].empty())
+            {
+                s += (first ? "" : ", ") + args[i]->toString();
+                first = false;
+            }
+            else
+                // gcc propagates this value
+                constants += "\t" + args[i]->toString() + " = " + VALUES[i] + ";\n";
+
+        if (first)
+            s += "void";
+
+        // After {\n
+        string content = BODY;
+        content.insert(2, constants);
+
+        return s + ") " + content;
+    }
+
+    string UpFunction::memoize(const string &ATTRIBUTE, const string &BODY) const
+    {
+        const string NAME = cName();
+        const string BODY_NAME = "_upMemoBody_" + NAME;
+        const string ENTRY = "_upMemoEntry_" + NAME;
+        const string CACHE = "_upMemo_" + NAME;
+        const string HITS = "_upMemoHits_" + NAME;
+        const string MISSES = "_upMemoMisses_" + NAME;
+        const string CAPACITY = to_string(modifiers.memoCapacity);
+
+        // Cache
+        string s = "// Results of " + id.toUp() + " (memo)\n";
+        s += "typedef struct {\n";
+        for (auto a : args)
+            s += "\t" + a->toString() + ";\n";
+        s += "\t" + cType(type.toUp()) + " _upResult;\n";
+        s += "\tunsigned char _upUsed;\n";
+        s += "} " + ENTRY + ";\n";
+        // * Each thread has its own cache (par loops and spawned calls)
+        s += "static _Thread_local " + ENTRY + " " + CACHE + "[" + CAPACITY + "];\n";
+
+        if (memoStats)
+        {
+            s += "#include <stdio.h>\n";
+            s += "static unsigned long " + HITS + ", " + MISSES + ";\n";
+            s += "__attribute__((destructor)) static void _upMemoStats_" + NAME + "(void) {\n";
+            s += "\tfprintf(stderr, \"memo " + id.toUp() + " : %lu hits, %lu misses\\n\", " +
+                "__atomic_load_n(&" + HITS + ", __ATOMIC_RELAXED), __atomic_load_n(&" + MISSES + ", __ATOMIC_RELAXED));\n";
+            s += "}\n";
+        }
+
+        s += "static " + signature(BODY_NAME) + ";\n";
+
+        // Wrapper
+        string key = "_upEntry->_upUsed";
+        string argNames;
+        s += (ATTRIBUTE.empty() ? "" : ATTRIBUTE + " ") + signature() + " {\n";
+        s += "\tunsigned long long _upHash = 0;\n";
+        for (auto a : args)
+        {
+            const string ARG = a->id.toC();
+
+            // The bits of a float
+            string bits = "(unsigned) " + ARG;
+            if (a->type == "num")
+            {
+                s += "\tunion { float f; unsigned u; } _upBits_" + ARG + " = { " + ARG + " };\n";
+                bits = "_upBits_" + ARG + ".u";
+            }
+
+            s += "\t_upHash = (_upHash ^ " + bits + ") * 0x100000001b3ull;\n";
+            key += " && _upEntry->" + ARG + " == " + ARG;
+            argNames += (argNames.empty() ? "" : ", ") + ARG;
+        }
+
+        s += "\t" + ENTRY + " *_upEntry = &" + CACHE + "[(_upHash ^ (_upHash >> 29)) % " + CAPACITY + "];\n";
+        s += "\tif (" + key + ") {\n";
+        if (memoStats)
+            s += "\t\t__atomic_fetch_add(&" + HITS + ", 1, __ATOMIC_RELAXED);\n";
+        s += "\t\treturn _upEntry->_upResult;\n";
+        s += "\t}\n";
+        if (memoStats)
+            s += "\t__atomic_fetch_add(&" + MISSES + ", 1, __ATOMIC_RELAXED);\n";
+
+        // The body may call this function and replace the entry
+        s += "\t" + cType(type.toUp()) + " _upResult = " + BODY_NAME + "(" + argNames + ");\n";
+        for (auto a : args)
+            s += "\t_upEntry->" + a->id.toC() + " = " + a->id.toC() + ";\n";
+        s += "\t_upEntry->_upResult = _upResult;\n";
+        s += "\t_upEntry->_upUsed = 1;\n";
+        s += "\treturn _upResult;\n";
+        s += "}\n";
+
+        // Function without cache
+        s += "static " + signature(BODY_NAME) + " " + BODY;
 
         return s;
     }
@@ -850,11 +2693,75 @@ namespace up
     {
         // Add args in body's scope
         for (auto a : args)
-            body->vars.push_back(new Variable(a->id, a->type));
+        {
+            auto v = new Variable(a->id, a->type);
+            v->noalias = a->noalias;
+            body->vars.push_back(v);
+        }
 
         Function::process(compiler);
 
+        if (modifiers.memo)
+        {
+            memoStats = compiler->memoStats;
+
+            if (type == "nil")
+                compiler->generateError("The function '" + AS_BLUE(id.toUp()) +
+                    "' can't be memoized because it returns '" + AS_BLUE("nil") + "'", info);
+
+            if (modifiers.memoCapacity <= 0)
+                compiler->generateError("The cache of the function '" + AS_BLUE(id.toUp()) +
+                    "' must have at least one entry", info);
+
+            // The arguments are the key of the cache
+            for (auto a : args)
+                if (a->type != "int" && a->type != "num" && a->type != "bool")
+                    compiler->generateError("The function '" + AS_BLUE(id.toUp()) +
+                        "' can't be memoized because the argument '" + AS_BLUE(a->id.toUp()) +
+                        "' has type '" + AS_BLUE(a->type.toUp()) + "' (only " + AS_BLUE("int") + ", " +
+                        AS_BLUE("num") + " and " + AS_BLUE("bool") + " can be used)", info);
+        }
+
+        // This function may be processed while processing a call (lazy mode)
+        // * The loops of the caller don't contain this body
+        UpFunction *caller = compiler->currentFunction;
+        auto callerRanges = move(compiler->loopRanges);
+        auto callerShared = move(compiler->sharedScopes);
+        auto callerUsages = move(compiler->usageScopes);
+        auto callerFutures = move(compiler->futures);
+        compiler->currentFunction = this;
+        compiler->loopRanges.clear();
+        compiler->sharedScopes.clear();
+        compiler->futures.clear();
+        compiler->usageScopes = { &objects };
+        cleanupLabels = 0;
+        cleanupJumps.clear();
+        checksReturning = false;
+        returns.clear();
+        spawns.clear();
+
+        objects.scopeDepth = compiler->scopes.size();
+        objects.arguments = true;
+        compiler->processedUsages.push_back(&objects);
+
         body->process(compiler);
+
+        for (auto r : returns)
+            r->setsReturning = checksReturning;
+
+        // The tasks are done when the function returns
+        if (!spawns.empty())
+        {
+            body->sync = true;
+            for (auto r : returns)
+                r->sync = true;
+        }
+
+        compiler->currentFunction = caller;
+        compiler->loopRanges = move(callerRanges);
+        compiler->sharedScopes = move(callerShared);
+        compiler->futures = move(callerFutures);
+        compiler->usageScopes = move(callerUsages);
     }
 
 } // namespace up
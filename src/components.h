@@ -4,6 +4,8 @@
 
 #include <string>
 #include <vector>
+#include <set>
+#include <map>
 #include <iostream>
 
 #include "error_info.h"
@@ -15,6 +17,13 @@ namespace up
     class Compiler;
     class Expression;
     class Block;
+    class Literal;
+    class VariableUsage;
+    class Call;
+    class Function;
+    class UpFunction;
+    class Interpreter;
+    struct LazyBody;
 
     // Interface which provides process and toString virtual functions
     class ISyntax
@@ -58,6 +67,10 @@ namespace up
         // !!! TYPE is a Up type
         bool compatibleType(const Id &TYPE) const;
 
+        // Returns the type named by this expression (argument of a generic type)
+        // * Empty id if this is not a type name
+        virtual Id typeName(Compiler *compiler) const;
+
     public:
         // Up type (can be auto)
         Id type;
@@ -84,6 +97,8 @@ namespace up
     // a++;
     class ExpressionStatement : public Statement
     {
+        friend class Interpreter;
+
     public:
         ExpressionStatement() = default;
         ExpressionStatement(const ErrorInfo &INFO, Expression *expr);
@@ -110,6 +125,9 @@ namespace up
     public:
         virtual std::string toString() const override;
 
+    public:
+        virtual void process(Compiler *compiler) override;
+
     private:
         std::string code;
     };
@@ -126,7 +144,48 @@ namespace up
         {}
 
     public:
-        virtual void pushDestructor(const std::string &des) = 0;
+        // Sets the cleanup label reached when a return leaves the
+        // blocks of this statement (-1 to return directly)
+        virtual void setCleanupExit(const int LABEL) = 0;
+    };
+
+    // A variable combined with an operator by the iterations of
+    // a par or simd loop (each thread / lane has its own copy)
+    // For example :
+    // reduce(+: total)
+    struct Reduction
+    {
+        // +, *, min or max
+        std::string op;
+        Id id;
+    };
+
+    // Annotations of a loop, emitted as pragmas before the loop
+    // For example :
+    // simd for i to n
+    // ivdep unroll(4) while i < n
+    // par reduce(+: total) for i to n
+    // * simd : #pragma omp simd (for loops only, gcc -fopenmp-simd)
+    // * ivdep : #pragma GCC ivdep (no dependency between the iterations)
+    // * unroll(N) : #pragma GCC unroll N
+    // * par : #pragma omp parallel for (for loops only, gcc -fopenmp),
+    //   the variables declared before the loop are shared by the threads
+    struct LoopHints
+    {
+        bool simd = false;
+        bool ivdep = false;
+        // Unroll factor (0 if not declared)
+        int unroll = 0;
+        bool par = false;
+        // reduction clauses of par and simd loops
+        std::vector<Reduction> reductions;
+
+        // Whether an annotation is declared
+        inline bool any() const
+        { return simd || ivdep || unroll || par || !reductions.empty(); }
+
+        // Returns the pragmas, each followed by a new line
+        std::string toString() const;
     };
 
     // When a statement contains only one block
@@ -138,8 +197,19 @@ namespace up
         virtual ~IMonoBlockStatement();
 
     public:
-        virtual void pushDestructor(const std::string &DES) override;
+        virtual void setCleanupExit(const int LABEL) override;
+
+    public:
+        // Annotations of a while or for loop
+        LoopHints hints;
     
+    protected:
+        // Processes the content and checks the annotations of the loop
+        // * The content must not declare objects with a destructor
+        //   (each iteration would call it), except within par loops
+        // * A simd or par loop must not return
+        void processLoop(Compiler *compiler);
+
     protected:
         Block *content;
     };
@@ -151,6 +221,8 @@ namespace up
     // if : KEYWORD
     class ControlStatement : public IMonoBlockStatement
     {
+        friend class Interpreter;
+
     public:
         ControlStatement() = default;
         ControlStatement(const ErrorInfo &INFO, Expression *condition, Block *content,
@@ -161,6 +233,15 @@ namespace up
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
 
+    public:
+        // Returns the literal if the condition is an int equality
+        // (see BinaryOperation::intEquality), nullptr otherwise
+        Literal *caseValue(VariableUsage *&variable) const;
+
+        // Returns the block as a case of a switch
+        // !!! caseValue must not be nullptr
+        std::string toCaseString() const;
+
     private:
         Expression *condition;
         std::string keyword;
@@ -168,6 +249,15 @@ namespace up
 
     // Sequence of if / or if / or
     // * Starts with a if
+    // * Emitted as a switch when each condition compares the same
+    //   int variable to a different int literal
+    // For example :
+    // op == 1 ?
+    //      block
+    // or op == 2 ?
+    //      block
+    // or op == 3 ?
+    //      block
     class ConditionSequence : public IBlockStatement
     {
     public:
@@ -180,11 +270,20 @@ namespace up
         virtual void process(Compiler *compiler) override;
 
     public:
-        virtual void pushDestructor(const std::string &DES) override;
+        virtual void setCleanupExit(const int LABEL) override;
 
     public:
         // If / or if / or block statements
         std::vector<Statement*> controls;
+
+    private:
+        // Returns whether the sequence can be a switch
+        // * Called after the process of the controls
+        bool isSwitchable() const;
+
+    private:
+        // The variable compared in each case (nullptr if not a switch)
+        VariableUsage *switchVar = nullptr;
     };
 
     // The or block
@@ -194,6 +293,8 @@ namespace up
     // !!! Used only in Block::createOrStatement
     class OrStatement : public IMonoBlockStatement
     {
+        friend class Interpreter;
+
     public:
         OrStatement() = default;
         OrStatement(const ErrorInfo &INFO, Block *content);
@@ -202,6 +303,29 @@ namespace up
     public:
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
+
+    public:
+        // Returns the block as the default case of a switch
+        std::string toDefaultString() const;
+    };
+
+    // Objects used within a loop or a function (see Compiler::restrictObjects)
+    struct ObjectUsages
+    {
+        // Number of usages of each variable declared before,
+        // except as the object of a method call
+        std::map<Variable*, int> usages;
+        // Method calls on these variables
+        std::vector<std::pair<Variable*, Call*>> methodCalls;
+        // Number of scopes before the content
+        size_t scopeDepth = 0;
+        // Whether the variables of the content are recorded
+        // (arguments of a function)
+        bool arguments = false;
+
+        // Objects whose elements are accessed with a restrict pointer
+        // (_upData_<name>)
+        std::vector<Variable*> restricted;
     };
 
     // A for loop
@@ -211,25 +335,91 @@ namespace up
     // i : VAR_ID, 0 : begin, 42 : end
     class ForStatement : public IMonoBlockStatement
     {
+        friend class Interpreter;
+
     public:
         // Creates a for statement with the default initializer (begin)
         static ForStatement *createDefaultInit(const ErrorInfo &INFO, const Id &VAR_ID,
-            Expression *end, Block *content);
+            Expression *end, Block *content, Expression *step=nullptr);
 
     public:
         ForStatement() = default;
+        // step can be nullptr (1 or -1 depending on the bounds)
         ForStatement(const ErrorInfo &INFO, const Id &VAR_ID, Expression *begin,
-            Expression *end, Block *content);
+            Expression *end, Block *content, Expression *step=nullptr);
         ~ForStatement();
 
     public:
+        // The end (and the step) are evaluated once
+        // For example :
+        // for (int i = 10, _upEnd = n; i > _upEnd; --i)
+        // * The bounds of a simd loop are declared before the loop
+        //   (canonical form of OpenMP)
+        //   { int _upEnd = n; #pragma omp simd for (int i = 0; i < _upEnd; ++i) }
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
 
+    public:
+        // Objects used within the loop, the restricted objects
+        // are declared before the loop
+        // For example :
+        // { __typeof__(a->data) restrict _upData_a = a->data; for (...) }
+        ObjectUsages objects;
+
     private:
         Expression *begin;
         Expression *end;
+        Expression *step;
         Id varId;
+
+        // Up type of the iterator (int or num)
+        Id iteratorType;
+
+        // 1 if ascending, -1 if descending, 0 if known only at runtime
+        int direction = 0;
+
+        // Whether the begin has not been written (0)
+        bool defaultBegin = false;
+    };
+
+    // The iterator of a for statement is within the bounds of an object
+    // (0 <= i < a.size())
+    // For example :
+    // for i to a.size()
+    // * The size of an object is fixed (see Compiler::checkAccess)
+    // * The object is nullptr if only the writes of the iterator are
+    //   recorded (simd loops)
+    struct LoopRange
+    {
+        Variable *iterator;
+        Variable *object;
+
+        // Checked accesses to the object with the iterator as index
+        // and the function without check
+        std::vector<std::pair<Call*, Function*>> accesses;
+
+        // Whether the iterator or the object is written within the loop
+        bool modified = false;
+        // Whether the iterator is written within the loop
+        bool iteratorModified = false;
+    };
+
+    // A par loop being processed, the variables declared before
+    // the loop are shared by the threads (see Compiler::recordWrite)
+    struct SharedScope
+    {
+        // Number of scopes before the content
+        size_t scopeDepth;
+
+        // The iterator, the element of a table indexed by the iterator
+        // is written by one thread
+        Variable *iterator;
+
+        // Variables which can be written (reductions)
+        std::vector<Variable*> reductions;
+
+        // Shared variables written within the loop (errors)
+        std::vector<Variable*> writes;
     };
 
     // A literal expression
@@ -247,7 +437,8 @@ namespace up
     public:
         virtual std::string toString() const override;
 
-    private:
+    public:
+        // The token (for example 42, -3.5, 'text', yes)
         std::string data;
     };
 
@@ -257,6 +448,13 @@ namespace up
     // Variable use : b (ID)
     class VariableUsage : public Expression
     {
+        friend class Interpreter;
+        friend class Compiler;
+        friend class ForStatement;
+        friend class BinaryOperation;
+        friend class Return;
+        friend class VariableAssignement;
+
     public:
         VariableUsage() = default;
         VariableUsage(const ErrorInfo &INFO, const Id &ID)
@@ -266,9 +464,74 @@ namespace up
     public:
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
+        virtual Id typeName(Compiler *compiler) const override;
+
+    public:
+        // Whether this usage doesn't make the variable escape
+        // (receiver of a method or destructor call)
+        bool borrowed = false;
+
+    private:
+        Id id;
+    };
+
+    // Access to an element of a table (constant or variable)
+    // For example :
+    // SINE[i]
+    // * A constant index is checked after the evaluation of
+    //   the constants (see checkBounds)
+    class Index : public Expression
+    {
+        friend class Interpreter;
+        friend class IndexAssignement;
+
+    public:
+        Index() = default;
+        Index(const ErrorInfo &INFO, const Id &ID, Expression *index);
+        ~Index();
+
+    public:
+        virtual std::string toString() const override;
+        virtual void process(Compiler *compiler) override;
+        // A generic type with one argument (Array[int])
+        virtual Id typeName(Compiler *compiler) const override;
+
+    public:
+        // Generates an error if the constant index is out of the table
+        void checkBounds(Compiler *compiler);
 
     private:
         Id id;
+        Expression *index;
+        // Number of values of the table (found by process)
+        int count = 0;
+    };
+
+    // Access to a field of an object
+    // For example :
+    // p.x : p->x
+    // ps[i].x : ps->x[i] (collection with the soa layout)
+    // * Reading a field doesn't make the object escape
+    class FieldUsage : public Expression
+    {
+        friend class Interpreter;
+
+    public:
+        FieldUsage() = default;
+        // index is nullptr if object is not a collection
+        FieldUsage(const ErrorInfo &INFO, Expression *object, const std::string &FIELD, Expression *index=nullptr);
+        ~FieldUsage();
+
+    public:
+        virtual std::string toString() const override;
+        virtual void process(Compiler *compiler) override;
+
+    private:
+        // The object or the collection
+        Expression *object;
+        std::string field;
+        // Index of the element within the collection
+        Expression *index;
     };
 
     // A function call with arg list
@@ -290,20 +553,56 @@ namespace up
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
 
+    public:
+        // Whether the same call can be reused (see Block::eliminateCalls)
+        // * The function is pure and the arguments are variables or literals
+        bool isReusable() const;
+
     public:
         Id id;
         std::vector<Expression*> args;
         bool isDestructor;
+
+        // The called function (found by process)
+        Function *function = nullptr;
+
+        // C values of the literal arguments if the call calls a copy
+        // of the function (see UpFunction::specialize), empty otherwise
+        std::vector<std::string> bound;
+
+        // Whether the call is run by a task (see Spawn), it is not
+        // specialized or reused
+        bool spawned = false;
+
+        // Whether the call is a checked access (see Compiler::checkAccess)
+        // and whether its check has been removed
+        bool checked = false;
+        bool unchecked = false;
+
+        // Restrict pointer to the elements of the object if this is
+        // an unchecked access (see ObjectUsages::restricted)
+        // For example :
+        // _upData_a[i]
+        std::string dataPointer;
+
+        // Temporary variable which holds the result of an identical call
+        // For example :
+        // (_upCse0 = cosf(x)) if cseDefines, _upCse0 otherwise
+        std::string cseName;
+        bool cseDefines = false;
     };
 
     // For example :
     // $a = 6
     class VariableDeclaration : public Statement
     {
+        friend class Interpreter;
+
     public:
         VariableDeclaration() = default;
         // expr can be nullptr if the variable is not init
-        VariableDeclaration(const ErrorInfo &INFO, const Id &ID, const Id &TYPE, Expression *expr);
+        // * COUNT is the number of values of a table (0 if this is not a table)
+        VariableDeclaration(const ErrorInfo &INFO, const Id &ID, const Id &TYPE, Expression *expr, const int COUNT=0);
         ~VariableDeclaration();
 
     public:
@@ -316,6 +615,10 @@ namespace up
         std::string parsedType;
         Id type;
         Id id;
+        int count;
+
+        // The declared variable (owned by the block)
+        Variable *variable = nullptr;
 
     private:
         // The expression which inits the variable
@@ -327,6 +630,8 @@ namespace up
     // a : ID, + : OPERAND, 6 : expr
     class VariableAssignement : public Statement
     {
+        friend class Interpreter;
+
     public:
         VariableAssignement() = default;
         VariableAssignement(const ErrorInfo &INFO, const Id &ID, Expression *expr, const std::string &OPERAND);
@@ -339,16 +644,80 @@ namespace up
     public:
         Id id;
 
+    private:
+        // Returns the loop of an element-wise operation
+        std::string fusedString() const;
+
     private:
         // The expression which modifies the variable
         Expression *expr;
         std::string operand;
+
+        // Whether the expression is an element-wise operation, which is
+        // computed by one loop (no temporary array)
+        // For example :
+        // c = a + b * k
+        // { int _upN = Array_num_size(c); ... for (int _upI = 0; _upI < _upN; ++_upI)
+        //     Array_num_atSetUnchecked(c, _upI, (... + (... * k))); }
+        bool fused = false;
+        // Arrays read by the operation
+        std::vector<const Expression*> arrays;
+        // Scalars evaluated once, before the loop (not literals or variables)
+        std::vector<const Expression*> scalars;
+        // C functions of the array type (T.size, T.atGetUnchecked, T.atSetUnchecked)
+        std::string sizeFunction, getter, setter;
+    };
+
+    // For example :
+    // buf[i] = 0.5
+    class IndexAssignement : public Statement
+    {
+        friend class Interpreter;
+
+    public:
+        IndexAssignement() = default;
+        IndexAssignement(const ErrorInfo &INFO, Index *element, Expression *expr, const std::string &OPERAND);
+        ~IndexAssignement();
+
+    public:
+        virtual std::string toString() const override;
+        virtual void process(Compiler *compiler) override;
+
+    private:
+        Index *element;
+        Expression *expr;
+        std::string operand;
+    };
+
+    // For example :
+    // p.x += 6
+    // ps[i].x = 0.0
+    // * The object is not replaced (it doesn't escape)
+    class FieldAssignement : public Statement
+    {
+        friend class Interpreter;
+
+    public:
+        FieldAssignement() = default;
+        FieldAssignement(const ErrorInfo &INFO, FieldUsage *field, Expression *expr, const std::string &OPERAND);
+        ~FieldAssignement();
+
+    public:
+        virtual std::string toString() const override;
+        virtual void process(Compiler *compiler) override;
+
+    private:
+        FieldUsage *field;
+        Expression *expr;
+        std::string operand;
     };
 
     // For example :
     // ret 3.14
     class Return : public Statement
     {
+        friend class Interpreter;
+
     public:
         Return() = default;
         // expr can be nullptr if the return is null
@@ -359,16 +728,93 @@ namespace up
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
 
+    public:
+        // The cleanup label to reach before returning (-1 if nothing to clean)
+        int cleanupLabel = -1;
+
+        // Whether the spawned calls are synced before (see Spawn)
+        bool sync = false;
+
+        // Whether _upReturning is set before the cleanups
+        // (see UpFunction::checksReturning)
+        bool setsReturning = false;
+
+        // The variable or the called function whose object is returned
+        // (see UpFunction::returnsBorrowed)
+        // * Both are nullptr for other expressions (fields, C code...)
+        Variable *returnedVar = nullptr;
+        Function *returnedCall = nullptr;
+
     private:
         // The expression which inits the variable
         Expression *expr;
     };
 
+    // A call run by a task of the work-stealing scheduler, its result
+    // is stored in the future variable which can be used after a sync
+    // For example :
+    // $a = spawn fib(n - 1)
+    // a : ID (empty if the result is not used), fib(n - 1) : call
+    // * The arguments are evaluated by the spawning thread
+    // * The spawned calls are synced at the end of the function, and at the
+    //   end of the blocks which contain spawns and declare futures or objects
+    //   with a destructor
+    class Spawn : public Statement
+    {
+    public:
+        Spawn() = default;
+        Spawn(const ErrorInfo &INFO, Call *call, const Id &ID=Id(), const Id &TYPE=Id());
+        ~Spawn();
+
+    public:
+        // For example :
+        // int a; { _UpSpawn_fib_0 *_upT = malloc(sizeof(*_upT)); ... _upSpawn(&_upFrame, &_upT->task); }
+        virtual std::string toString() const override;
+        virtual void process(Compiler *compiler) override;
+
+    public:
+        // Returns the type of the task (result pointer and arguments) and the
+        // function which runs the call, emitted before the spawning function
+        // For example :
+        // typedef struct { _UpTask task; int *result; int a0; } _UpSpawn_fib_0;
+        // static void _upRun_fib_0(_UpTask *task) { ... *t->result = fib(t->a0); free(t); }
+        std::string taskCode() const;
+
+    private:
+        Call *call;
+        Id id;
+        Id type;
+
+        // The future (nullptr if the result is not used)
+        Variable *future = nullptr;
+
+        // Suffix of the task names (<function>_<index>)
+        std::string name;
+    };
+
+    // Waits for the calls spawned by the function
+    // For example :
+    // sync
+    class Sync : public Statement
+    {
+    public:
+        Sync() = default;
+        Sync(const ErrorInfo &INFO)
+            : Statement(INFO)
+        {}
+
+    public:
+        virtual std::string toString() const override;
+        virtual void process(Compiler *compiler) override;
+    };
+
     // For example :
     // a++
     // a : ID, ++ : OPERAND
     class UnaryOperation : public Expression
     {
+        friend class Interpreter;
+
     public:
         UnaryOperation() = default;
         UnaryOperation(const ErrorInfo &INFO, const Id &ID, const std::string &OPERAND, const bool PREFIX=false);
@@ -390,6 +836,8 @@ namespace up
     // a : first, 42 : second, + : OPERAND
     class BinaryOperation : public Expression
     {
+        friend class Interpreter;
+
     public:
         BinaryOperation() = default;
         // If CONDITION, the type is bool
@@ -400,6 +848,30 @@ namespace up
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
 
+    public:
+        // If this is a comparison between an int variable and
+        // an int literal (a == 42 or 42 == a), returns the literal
+        // and sets variable, otherwise returns nullptr
+        Literal *intEquality(VariableUsage *&variable) const;
+
+        // Returns the C expression of the element I of an element-wise
+        // operation, the SCALARS are replaced by their temporary variable
+        // For example :
+        // (Array_num_atGetUnchecked(a, _upI) + _upS0)
+        std::string elementString(const std::string &I,
+            const std::map<const Expression*, std::string> &SCALARS) const;
+
+        // Adds the operands of an element-wise operation
+        // which are arrays and the other operands (scalars)
+        void elementOperands(std::vector<const Expression*> &arrays,
+            std::vector<const Expression*> &scalars) const;
+
+    public:
+        // Whether an operand is an array (see VariableAssignement)
+        bool elementWise = false;
+        // C function which reads an element of the arrays (T.atGetUnchecked)
+        std::string getter;
+
     private:
         std::string operand;
         Expression *first;
@@ -408,10 +880,42 @@ namespace up
         bool condition;
     };
 
+    // Destructor call of a variable when its block exits
+    // For example :
+    // _upClean2:
+    //     Array_del(a);
+    struct Cleanup
+    {
+        // The label is _upClean<label> (unique within the function)
+        int label;
+        Variable *var;
+        // T.del call (can be empty)
+        std::string call;
+        // T.fini call if the variable is on the stack
+        std::string stackCall;
+        // Whether the object may be the returned value (not destroyed in this case)
+        bool mayBeReturned;
+        // Whether the variable owns its object (see Block::releaseBorrowed)
+        bool owned = true;
+    };
+
+    // A call within a statement of a block
+    struct CallSite
+    {
+        // Index of the statement in the block
+        size_t statement;
+        Call *call;
+    };
+
     // A block is like the body of a function or a if statement
     // This gathers indented statements and other instructions
+    // * Variables declared in the block are destroyed in reverse order at
+    //   the end of the block, a return jumps to the cleanup of the last
+    //   declared variable and then each block goes to its exit label
     class Block : public ISyntax
     {
+        friend class Interpreter;
+
     public:
         Block() = default;
         Block(const ErrorInfo &INFO)
@@ -430,17 +934,113 @@ namespace up
         // Adds a statement in the content        
         void pushStatement(Statement *s);
 
+        // The variable (C name) is modified by the current statement
+        void recordWrite(const std::string &NAME);
+
+        // Reuses the results of pure calls already made by a previous
+        // statement with the same arguments (common subexpression elimination)
+        // * Purity of functions must be inferred before
+        // * f is the function of the block
+        void eliminateCalls(UpFunction *f);
+
+        // Removes the cleanups of the variables which don't own their object
+        // (copies and borrowed results), they are destroyed by their owner
+        // * All functions must be processed before
+        void releaseBorrowed(UpFunction *f);
+
     public:
         std::vector<Variable*> vars;
 
-        // All destructors as string
-        std::string destructors;
+        // Destructor calls of the variables declared in this block
+        std::vector<Cleanup> cleanups;
+
+        // The cleanup label of the parent block when this block
+        // has been entered (-1 if the function returns directly)
+        int exitLabel = -1;
+
+        // How to exit after the cleanups (during a return)
+        std::string exitStatement;
+
+        // The cleanup labels of the function which are the target of
+        // a goto (see UpFunction::cleanupJumps), set by process
+        const std::set<int> *cleanupJumps = nullptr;
+
+        // Index of the statement being processed
+        size_t currentStatement = 0;
+
+        // Calls which are not within a sub block
+        std::vector<CallSite> callSites;
+
+        // Statements after which no call can be reused
+        // (C sections and statements with blocks)
+        std::set<size_t> barriers;
+
+        // Variables modified by each statement
+        std::vector<std::pair<size_t, std::string>> writes;
+
+        // Declarations of the temporary variables of the reused calls
+        std::string cseDeclarations;
+
+        // Whether the block or a sub block contains a spawn, and whether
+        // the spawned calls are synced at the end of the block (before
+        // the cleanups)
+        bool spawned = false;
+        bool sync = false;
     
+    private:
+        // Returns the call of the method T.NAME() on the variable
+        // or an empty string if this method doesn't exist
+        std::string cleanupCall(Compiler *compiler, Variable *v, const std::string &NAME);
+
     private:
         // The content
         std::vector<Statement*> content;
     };
 
+    // A value computed by the compiler (see Interpreter)
+    // * A table has count values, each value is the expression
+    //   evaluated with the index variable (from 0 to count - 1)
+    // For example :
+    // const int SIZE = 4 * 64
+    // const num[256] SINE for i = sinf(i * 0.0245)
+    class Constant : public ISyntax
+    {
+    public:
+        Constant() = default;
+        // expr is nullptr if the values are already computed (precompiled module)
+        Constant(const ErrorInfo &INFO, const Id &TYPE, const Id &ID, Expression *expr,
+            const int COUNT=0, const Id &INDEX=Id());
+        ~Constant();
+
+    public:
+        // The static const C declaration
+        virtual std::string toString() const override;
+        // Checks the expression, values are computed by evaluate
+        virtual void process(Compiler *compiler) override;
+
+        // Computes the values
+        // Returns false if there is an error
+        bool evaluate(Compiler *compiler);
+
+    public:
+        // Used by expressions (count is the size of a table)
+        Variable variable;
+        // The C literal of each value
+        std::vector<std::string> values;
+
+        // Whether the values have been computed (by this or a previous compilation)
+        bool evaluated = false;
+        // Whether evaluate is running (a constant can't depend on itself)
+        bool evaluating = false;
+        bool processed = false;
+
+    private:
+        Expression *expr;
+        Id index;
+        // Scope of the index variable
+        Block *scope;
+    };
+
     // An argument within a function definition
     // For example :
     // int main(int argc)
@@ -454,7 +1054,7 @@ namespace up
 
     public:
         Argument() = default;
-        Argument(const ErrorInfo &INFO, const Id &TYPE, const Id &ID);
+        Argument(const ErrorInfo &INFO, const Id &TYPE, const Id &ID, const bool NOALIAS=false);
 
     public:
         virtual std::string toString() const override;
@@ -472,6 +1072,32 @@ namespace up
         // The up type and id
         Id type,
             id;
+
+        // Whether the object is not accessed through the other
+        // arguments within the function
+        // For example :
+        // nil add(noalias Array[num] a, noalias Array[num] b)
+        bool noalias = false;
+    };
+
+    // Side effects of a function (from the weakest guarantee)
+    // * Pure : No side effect but reads memory (objects)
+    // * Const : Depends only on the values of the arguments
+    enum class Purity { Impure, Pure, Const };
+
+    // Written before the return type of a function
+    // For example :
+    // pure num len(Vec v)
+    // cdef const num cosf(num x)
+    // memo(4096) int fib(int n)
+    struct FunctionModifiers
+    {
+        Purity purity = Purity::Impure;
+
+        // Whether the results are cached (see UpFunction::memoize)
+        bool memo = false;
+        // Number of entries of the cache
+        int memoCapacity = 1024;
     };
 
     // Describes a function, can be a cdef or updef
@@ -494,7 +1120,10 @@ namespace up
 
     public:
         // The c signature (without ;)
-        std::string signature() const;
+        // * NAME replaces the C name if not empty
+        std::string signature(const std::string &NAME="") const;
+        // The gcc attribute of the declared purity (can be empty)
+        std::string attribute() const;
         // Returns the mangled name
         std::string cName() const
         {
@@ -503,12 +1132,21 @@ namespace up
             return id.toC();
         }
 
+        // Whether the returned object may belong to the caller (an
+        // argument or a field of an argument), the caller must not destroy it
+        // * A cdef method returns a borrowed object if it returns another
+        //   type (Array.atGet), constructors and T.add return new objects
+        virtual bool returnsBorrowed()
+        { return borrows; }
+
     public:
         bool operator==(const Function &OTHER) const;
 
     public:
         // To check whether this function is defined in c or up
         bool isCDef;
+        // Whether process has been called (by this or a previous compilation)
+        bool processed = false;
         // Whether this is an object's method
         bool isMethod = false;
         bool isDestructor = false;
@@ -517,6 +1155,21 @@ namespace up
         Id type;
         // Name
         Id id;
+
+        // Whether the returned object is borrowed (cdef or precompiled
+        // function, see returnsBorrowed)
+        bool borrows = false;
+
+        // Declared modifiers
+        FunctionModifiers modifiers;
+        // The declared purity or the inferred purity (up functions)
+        Purity purity = Purity::Impure;
+
+        // Whether the generated C has simd loops, par loops or
+        // spawned calls (see Compiler::gccFlags)
+        bool usesSimd = false;
+        bool usesPar = false;
+        bool usesSpawn = false;
     };
 
     // A function defined in up
@@ -537,8 +1190,92 @@ namespace up
         virtual std::string toString() const override;
         virtual void process(Compiler *compiler) override;
 
+        // Whether a return returns an argument, a field, a copy or
+        // the result of a function which returns a borrowed object
+        virtual bool returnsBorrowed() override;
+
     public:
         // Instructions
         Block *body;
+
+        // Number of cleanup labels (see Block)
+        int cleanupLabels = 0;
+
+        // Cleanup labels reached by a goto (return or exit of a sub block),
+        // the other labels are reached at the end of their block and
+        // are not emitted
+        std::set<int> cleanupJumps;
+
+        // Whether a cleanup checks _upReturning (exit of a sub block or
+        // object which may be returned), the variable is declared and
+        // set by the returns only in this case
+        bool checksReturning = false;
+
+        // Processed returns
+        std::vector<Return*> returns;
+
+        // Whether returnsBorrowed is running (recursive calls)
+        bool checkingReturns = false;
+
+        // Spawned calls (the body declares the frame _upFrame)
+        std::vector<Spawn*> spawns;
+
+        // The source of the body if it is not parsed yet (lazy mode)
+        // * The body is parsed when the function is called
+        LazyBody *lazyBody = nullptr;
+
+        // Functions called by this function (purity inference)
+        std::set<Function*> callees;
+        // Whether the body has side effects without its calls (C sections)
+        bool hasSideEffects = false;
+
+        // Number of temporary variables of the reused calls
+        int cseTemps = 0;
+
+        // Whether hits and misses of the cache are displayed at exit (memo)
+        bool memoStats = false;
+
+        // Objects used by the body, the body is emitted in an inlined
+        // function whose restrict arguments are the elements of the
+        // restricted objects (gcc ignores restrict local pointers)
+        // For example :
+        // _upNoalias_axpy(y, x, k, y->data, x->data)
+        ObjectUsages objects;
+
+    public:
+        // Returns the values of the copy of this function for the literal
+        // arguments of a call, the copy is created if it doesn't exist
+        // Returns an empty vector if no argument can be bound or if this
+        // function has already MAX copies
+        std::vector<std::string> specialize(const std::vector<Expression*> &ARGS, const int MAX);
+
+        // Creates the copy with these VALUES if it doesn't exist
+        void addSpecialization(const std::vector<std::string> &VALUES);
+
+        // C name of the copy with these VALUES
+        std::string specializationName(const std::vector<std::string> &VALUES) const;
+
+    public:
+        // Copies of the function with constant arguments, each copy
+        // contains the C value of each argument (empty if not bound)
+        // * Copies are created for one compilation (see Compiler::compile)
+        // For example :
+        // resample(buf, 4) calls _upSpec0_resample(buf), whose
+        // body begins with int factor = 4;
+        std::vector<std::vector<std::string>> specializations;
+
+        // Copies called by the body (callee, values), they are created
+        // again when a cached module reuses this function
+        std::vector<std::pair<UpFunction*, std::vector<std::string>>> specializedCalls;
+
+    private:
+        // Returns the copy I with the BODY
+        std::string specializationString(const int I, const std::string &ATTRIBUTE, const std::string &BODY) const;
+
+        // Returns the function with a cache of results which calls
+        // the function renamed _upMemoBody_<name> (memo modifier)
+        // * The cache is direct mapped, an entry replaces
+        //   the previous entry with the same hash
+        std::string memoize(const std::string &ATTRIBUTE, const std::string &BODY) const;
     };
 }
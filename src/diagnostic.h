@@ -0,0 +1,27 @@
+#pragma once
+
+// Structured errors returned by the compiler
+
+#include <string>
+
+#include "error_info.h"
+
+namespace up
+{
+    // For example :
+    // reason : Syntax, message : unexpected Identifier
+    struct Diagnostic
+    {
+        Diagnostic() = default;
+        Diagnostic(const std::string &REASON, const std::string &MSG, const ErrorInfo &INFO)
+            : reason(REASON), message(MSG), info(INFO)
+        {}
+
+        // Category of the error (Syntax, Generation, Token...)
+        std::string reason;
+        // The message without colors
+        std::string message;
+        // Where the error happens
+        ErrorInfo info;
+    };
+} // namespace up
@@ -0,0 +1,287 @@
+#include "generic.h"
+
+#include <regex>
+#include <map>
+#include <functional>
+#include <cctype>
+
+#include "types.h"
+
+using namespace std;
+
+namespace up
+{
+    namespace
+    {
+        inline bool isIdChar(const char C)
+        { return isalnum(C) || C == '_'; }
+
+        // Lines of SRC with whether they begin within a C section
+        vector<pair<string, bool>> splitLines(const string &SRC)
+        {
+            vector<pair<string, bool>> lines;
+            bool inC = false;
+            size_t begin = 0;
+
+            while (begin <= SRC.size())
+            {
+                size_t end = SRC.find('\n', begin);
+                if (end == string::npos)
+                    end = SRC.size();
+
+                const string LINE = SRC.substr(begin, end - begin);
+                lines.push_back({ LINE, inC });
+
+                for (size_t i = 0; i < LINE.size(); ++i)
+                {
+                    if (inC)
+                    {
+                        if (LINE.compare(i, 2, "%}") == 0)
+                            inC = false;
+                    }
+                    // Comment
+                    else if (LINE[i] == '#')
+                        break;
+                    // String
+                    else if (LINE[i] == '\'')
+                    {
+                        for (++i; i < LINE.size() && LINE[i] != '\''; ++i)
+                            if (LINE[i] == '\\')
+                                ++i;
+                    }
+                    else if (LINE.compare(i, 2, "%{") == 0)
+                        inC = true;
+                }
+
+                if (end == SRC.size())
+                    break;
+
+                begin = end + 1;
+            }
+
+            return lines;
+        }
+
+        // Replaces the generic name and its prefixes (Name_ and _Name)
+        // For example :
+        // Array, _Array, Array_init : Array_int, _Array_int, Array_int_init
+        // * my_Array_buf is not renamed
+        string rename(const string &ID, const string &NAME, const string &INSTANCE)
+        {
+            // Already renamed (C sections of the default instance)
+            if (ID.compare(0, INSTANCE.size(), INSTANCE) == 0 &&
+                    (ID.size() == INSTANCE.size() || ID[INSTANCE.size()] == '_'))
+                return ID;
+
+            const size_t BEGIN = ID.compare(0, NAME.size() + 1, "_" + NAME) == 0 ? 1 : 0;
+            const size_t END = BEGIN + NAME.size();
+
+            if (ID.compare(BEGIN, NAME.size(), NAME) != 0 || (END < ID.size() && ID[END] != '_'))
+                return ID;
+
+            return ID.substr(0, BEGIN) + INSTANCE + ID.substr(END);
+        }
+
+        // Returns SRC where each identifier is replaced by REPLACE(ID, IN_C, END)
+        // (END is the index after the identifier), strings, comments and
+        // numbers are kept
+        string replaceIds(const string &SRC, const function<string(const string&, bool, size_t)> &REPLACE)
+        {
+            string result;
+            bool inC = false;
+
+            for (size_t i = 0; i < SRC.size(); )
+            {
+                const char C = SRC[i];
+
+                if (!inC && SRC.compare(i, 2, "%{") == 0)
+                {
+                    inC = true;
+                    result += "%{";
+                    i += 2;
+                }
+                else if (inC && SRC.compare(i, 2, "%}") == 0)
+                {
+                    inC = false;
+                    result += "%}";
+                    i += 2;
+                }
+                // Up comment
+                else if (!inC && C == '#')
+                {
+                    size_t end = SRC.find('\n', i);
+                    if (end == string::npos)
+                        end = SRC.size();
+
+                    result += SRC.substr(i, end - i);
+                    i = end;
+                }
+                // Strings (up) and strings / chars (C)
+                else if ((!inC && C == '\'') || (inC && (C == '"' || C == '\'')))
+                {
+                    size_t end = i + 1;
+                    while (end < SRC.size() && SRC[end] != C && SRC[end] != '\n')
+                        end += SRC[end] == '\\' ? 2 : 1;
+
+                    end = min(end + 1, SRC.size());
+                    result += SRC.substr(i, end - i);
+                    i = end;
+                }
+                else if (isalpha(C) || C == '_')
+                {
+                    size_t end = i;
+                    while (end < SRC.size() && isIdChar(SRC[end]))
+                        ++end;
+
+                    result += REPLACE(SRC.substr(i, end - i), inC, end);
+                    i = end;
+                }
+                // Numbers (1e5f is not an identifier)
+                else if (isdigit(C))
+                {
+                    size_t end = i;
+                    while (end < SRC.size() && isIdChar(SRC[end]))
+                        ++end;
+
+                    result += SRC.substr(i, end - i);
+                    i = end;
+                }
+                else
+                {
+                    result += C;
+                    ++i;
+                }
+            }
+
+            return result;
+        }
+    } // namespace
+
+    string extractGenerics(const Module &MOD, const string &SRC, vector<GenericDecl> &generics)
+    {
+        static const regex HEADER("^obj[ \t]+([a-zA-Z][a-zA-Z0-9]*)[ \t]*\\[([^\\]]*)\\][ \t]*(?:#.*)?$");
+        static const regex PARAM("^[ \t]*([a-zA-Z][a-zA-Z0-9]*)[ \t]*(?:=[ \t]*([a-zA-Z][a-zA-Z0-9]*)[ \t]*)?$");
+
+        const auto LINES = splitLines(SRC);
+        string result;
+        // Index of the template being extracted, -1 if none
+        int current = -1;
+
+        for (size_t l = 0; l < LINES.size(); ++l)
+        {
+            const auto &[LINE, IN_C] = LINES[l];
+            const bool TOP_LEVEL = !IN_C && !LINE.empty() && LINE[0] != ' ' && LINE[0] != '\t';
+            string kept;
+            smatch match;
+
+            // Another type ends the template
+            if (TOP_LEVEL && LINE.compare(0, 3, "obj") == 0 && (LINE.size() == 3 || !isIdChar(LINE[3])))
+                current = -1;
+
+            if (TOP_LEVEL && regex_match(LINE, match, HEADER))
+            {
+                GenericDecl g;
+                g.info = ErrorInfo(MOD, l + 1, 1);
+                g.id = Id(match[1].str());
+
+                // Parameters separated by commas
+                const string PARAMS = match[2].str();
+                for (size_t i = 0; i <= PARAMS.size(); )
+                {
+                    size_t next = PARAMS.find(',', i);
+                    if (next == string::npos)
+                        next = PARAMS.size();
+
+                    const string P = PARAMS.substr(i, next - i);
+                    smatch param;
+                    const bool VALID = regex_match(P, param, PARAM);
+                    g.params.push_back(VALID ? param[1].str() : "");
+                    g.defaults.push_back(VALID ? param[2].str() : "");
+
+                    i = next + 1;
+                }
+
+                current = generics.size();
+                generics.push_back(g);
+            }
+            // Imports stay within the module
+            else if (current >= 0 && TOP_LEVEL && LINE.compare(0, 4, "use ") == 0)
+            {
+                generics[current].text += "\n";
+                kept = LINE;
+            }
+            else if (current >= 0)
+                generics[current].text += LINE + "\n";
+            else
+                kept = LINE;
+
+            result += kept;
+            if (l + 1 < LINES.size())
+                result += "\n";
+        }
+
+        return result;
+    }
+
+    Id instanceName(const Id &GENERIC, const vector<Id> &ARGS)
+    {
+        string name = GENERIC.name();
+        for (auto &arg : ARGS)
+            name += "_" + arg.name();
+
+        return Id(name);
+    }
+
+    string instantiateSource(const GenericDecl &GENERIC, const vector<Id> &ARGS)
+    {
+        const string NAME = GENERIC.id.name();
+        const string INSTANCE = instanceName(GENERIC.id, ARGS).name();
+
+        // Parameter -> (up type, C type)
+        map<string, pair<string, string>> types;
+        for (size_t i = 0; i < GENERIC.params.size() && i < ARGS.size(); ++i)
+            types[GENERIC.params[i]] = { ARGS[i].name(), cType(ARGS[i].name()) };
+
+        auto replace = [&](const string &ID, const bool IN_C, size_t) -> string
+        {
+            auto type = types.find(ID);
+
+            if (type != types.end())
+                return IN_C ? type->second.second : type->second.first;
+
+            return rename(ID, NAME, INSTANCE);
+        };
+
+        return "obj " + INSTANCE + "\n" + replaceIds(GENERIC.text, replace);
+    }
+
+    bool hasDefaultInstance(const GenericDecl &GENERIC)
+    {
+        for (auto &d : GENERIC.defaults)
+            if (d.empty())
+                return false;
+
+        return !GENERIC.defaults.empty();
+    }
+
+    string useDefaultInstance(const GenericDecl &GENERIC, const string &SRC)
+    {
+        vector<Id> args;
+        for (auto &d : GENERIC.defaults)
+            args.push_back(Id(d));
+
+        const string NAME = GENERIC.id.name();
+        const string INSTANCE = instanceName(GENERIC.id, args).name();
+
+        auto replace = [&](const string &ID, const bool IN_C, const size_t END) -> string
+        {
+            // Array[int]
+            if (!IN_C && ID == NAME && END < SRC.size() && SRC[END] == '[')
+                return ID;
+
+            return rename(ID, NAME, INSTANCE);
+        };
+
+        return replaceIds(SRC, replace);
+    }
+} // namespace up
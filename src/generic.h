@@ -0,0 +1,59 @@
+#pragma once
+
+// Generic types (monomorphization)
+// The declaration of a generic obj is a template : its source is parsed
+// again for each list of type arguments, the parameters and the name of
+// the type are replaced within the up code and the C sections
+// For example :
+// obj Array[T]
+// Array[int] is parsed like obj Array_int (T is int)
+
+#include <string>
+#include <vector>
+
+#include "id.h"
+#include "module.h"
+#include "error_info.h"
+
+namespace up
+{
+    // For example :
+    // obj Array[T=num]
+    // id : Array, params : { T }, defaults : { num }
+    struct GenericDecl
+    {
+        // Location of the header
+        ErrorInfo info;
+        Id id;
+        std::vector<std::string> params;
+        // Default type of each parameter (empty if none)
+        std::vector<std::string> defaults;
+        // The source after the header, until the next obj declaration
+        // (use lines are kept within the module)
+        std::string text;
+    };
+
+    // Removes the generic obj declarations of SRC and appends them to generics
+    // (the number of lines doesn't change)
+    std::string extractGenerics(const Module &MOD, const std::string &SRC, std::vector<GenericDecl> &generics);
+
+    // Returns the name of the instance
+    // For example :
+    // Array[int] : Array_int
+    Id instanceName(const Id &GENERIC, const std::vector<Id> &ARGS);
+
+    // Returns the source of the instance (the header is at the line of the generic)
+    // * ARGS are up types, C sections use their C types
+    std::string instantiateSource(const GenericDecl &GENERIC, const std::vector<Id> &ARGS);
+
+    // Whether the generic is its default instance when it is used without
+    // type arguments (all the parameters have a default type)
+    bool hasDefaultInstance(const GenericDecl &GENERIC);
+
+    // Returns SRC where the generic used without type arguments is replaced
+    // by its default instance (up code and C sections)
+    // For example :
+    // obj Array[T=num]
+    // Array(4), Array a, Array_size(a) : Array_num(4), Array_num a, Array_num_size(a)
+    std::string useDefaultInstance(const GenericDecl &GENERIC, const std::string &SRC);
+} // namespace up
@@ -0,0 +1,563 @@
+// Hand written lexer, replaces the flex lexer (lexer.l) when
+// compiled with UP_HAND_LEXER (make LEXER_IMPL=hand)
+// It returns the same tokens as lexer.l, long runs (blanks, comments,
+// C sections, strings) are scanned with SSE2 / AVX2
+#ifdef UP_HAND_LEXER
+
+#include <cstring>
+
+#include "scanner.h"
+#include "compiler.h"
+#include "error_info.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define UP_LEXER_X86
+#endif
+
+using namespace std;
+
+namespace up
+{
+    namespace
+    {
+        // Search functions
+        // * end is returned if nothing is found
+        typedef const char *(*FindFunction)(const char *p, const char *end, const char C);
+        typedef const char *(*SkipFunction)(const char *p, const char *end);
+
+        // Returns the first C of [p, end)
+        const char *findScalar(const char *p, const char *end, const char C)
+        {
+            auto found = (const char*) memchr(p, C, end - p);
+
+            return found ? found : end;
+        }
+
+        // Returns the first character of [p, end) which is not a blank (space or tab)
+        const char *skipBlanksScalar(const char *p, const char *end)
+        {
+            while (p < end && (*p == ' ' || *p == '\t'))
+                ++p;
+
+            return p;
+        }
+
+#ifdef UP_LEXER_X86
+        const char *findSse2(const char *p, const char *end, const char C)
+        {
+            const __m128i CHAR = _mm_set1_epi8(C);
+
+            for ( ; end - p >= 16; p += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*) p);
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, CHAR));
+
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+
+            return findScalar(p, end, C);
+        }
+
+        const char *skipBlanksSse2(const char *p, const char *end)
+        {
+            const __m128i SPACE = _mm_set1_epi8(' ');
+            const __m128i TAB = _mm_set1_epi8('\t');
+
+            for ( ; end - p >= 16; p += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*) p);
+                int mask = _mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(v, SPACE), _mm_cmpeq_epi8(v, TAB)));
+
+                if (mask != 0xFFFF)
+                    return p + __builtin_ctz(~mask);
+            }
+
+            return skipBlanksScalar(p, end);
+        }
+
+        __attribute__((target("avx2")))
+        const char *findAvx2(const char *p, const char *end, const char C)
+        {
+            const __m256i CHAR = _mm256_set1_epi8(C);
+
+            for ( ; end - p >= 32; p += 32)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i*) p);
+                unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, CHAR));
+
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+
+            return findSse2(p, end, C);
+        }
+
+        __attribute__((target("avx2")))
+        const char *skipBlanksAvx2(const char *p, const char *end)
+        {
+            const __m256i SPACE = _mm256_set1_epi8(' ');
+            const __m256i TAB = _mm256_set1_epi8('\t');
+
+            for ( ; end - p >= 32; p += 32)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i*) p);
+                unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, SPACE), _mm256_cmpeq_epi8(v, TAB)));
+
+                if (mask != 0xFFFFFFFF)
+                    return p + __builtin_ctz(~mask);
+            }
+
+            return skipBlanksSse2(p, end);
+        }
+
+        // The best implementation for this CPU
+        const bool HAS_AVX2 = __builtin_cpu_supports("avx2");
+        const FindFunction findVector = HAS_AVX2 ? findAvx2 : findSse2;
+        const SkipFunction skipBlanksVector = HAS_AVX2 ? skipBlanksAvx2 : skipBlanksSse2;
+#else
+        const FindFunction findVector = findScalar;
+        const SkipFunction skipBlanksVector = skipBlanksScalar;
+#endif
+
+        // Returns the first C of [p, end)
+        inline const char *find(const char *p, const char *end, const char C)
+        {
+            return findVector(p, end, C);
+        }
+
+        // Returns the first character of [p, end) which is not a blank
+        // * Most runs are short, the first character is checked before
+        inline const char *skipBlanks(const char *p, const char *end)
+        {
+            if (p == end || (*p != ' ' && *p != '\t'))
+                return p;
+
+            return skipBlanksVector(p + 1, end);
+        }
+
+        inline bool isDigit(const char C)
+        { return C >= '0' && C <= '9'; }
+
+        inline bool isLetter(const char C)
+        { return (C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z'); }
+
+        // Returns the end of the C section which begins at P (%{)
+        // or nullptr if it is not terminated
+        // * Like ([^%]|%[^\}])*, a % is always paired with the next character
+        const char *cSectionEnd(const char *p, const char *end)
+        {
+            for (p += 2; ; p += 2)
+            {
+                p = find(p, end, '%');
+
+                if (end - p < 2)
+                    return nullptr;
+
+                if (p[1] == '}')
+                    return p + 2;
+            }
+        }
+    } // namespace
+
+    Parser::symbol_type Scanner::next()
+    {
+        const char *begin = source.data();
+        const char *end = begin + source.size();
+
+        while (true)
+        {
+            const char *p = begin + cursor;
+
+            if (p == end)
+                return Parser::make_END(loc);
+
+            // Rules with ^ (empty lines, comment lines and indentation)
+            if (atBol)
+            {
+                atBol = false;
+
+                // $ : The line must end with a new line
+                const char *blank = skipBlanks(p, end);
+                const char *eol = blank;
+
+                if (blank != end && *blank == '#')
+                    eol = find(blank, end, '\n');
+
+                if (eol != end && *eol == '\n' && eol != p)
+                {
+                    consume(eol - p);
+                    continue;
+                }
+
+                // Tabs or groups of 4 spaces
+                int tabs = 0;
+                const char *q = p;
+                while (true)
+                    if (q != end && *q == '\t')
+                    {
+                        ++q;
+                        ++tabs;
+                    }
+                    else if (end - q >= 4 && memcmp(q, "    ", 4) == 0)
+                    {
+                        q += 4;
+                        ++tabs;
+                    }
+                    else
+                        break;
+
+                if (tabs)
+                {
+                    consume(q - p);
+                    return Parser::make_INDENT_UPDT(tabs, loc);
+                }
+            }
+
+            const char C = *p;
+            const char NEXT = end - p >= 2 ? p[1] : '\0';
+
+            switch (C)
+            {
+            case '\n':
+                consume(1);
+                loc.lines();
+                atBol = true;
+                return Parser::make_NL(loc);
+
+            // Each blank is a match in lexer.l
+            case ' ':
+            case '\t':
+            {
+                const size_t COUNT = skipBlanks(p, end) - p;
+                loc.columns(COUNT - 1);
+                consume(1);
+                cursor += COUNT - 1;
+                continue;
+            }
+
+            case '#':
+            {
+                const char *eol = find(p, end, '\n');
+
+                if (eol == end)
+                    break;
+
+                consume(eol - p);
+                continue;
+            }
+
+            case '%':
+                // C section
+                if (NEXT == '{')
+                {
+                    if (const char *sectionEnd = cSectionEnd(p, end))
+                    {
+                        consume(sectionEnd - p);
+                        return Parser::make_CCODE(string(p, sectionEnd), loc);
+                    }
+                }
+                // Lazy body
+                else if (NEXT == '[')
+                {
+                    const char *q = p + 2;
+                    while (q != end && isDigit(*q))
+                        ++q;
+
+                    if (q != p + 2 && q != end && *q == ']')
+                    {
+                        consume(q + 1 - p);
+                        return Parser::make_LAZY(atoi(p + 2), loc);
+                    }
+                }
+                else if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_MODEQ(loc);
+                }
+
+                consume(1);
+                return Parser::make_MOD(loc);
+
+            case '\'':
+            {
+                // The longest match ends with the last quote of the line
+                const char *eol = find(p + 1, end, '\n');
+                const char *last = eol - 1;
+                while (last > p && *last != '\'')
+                    --last;
+
+                if (last == p)
+                    break;
+
+                consume(last + 1 - p);
+                return Parser::make_STR(string(p, last + 1), loc);
+            }
+
+            case '$':
+                consume(1);
+                return Parser::make_AUTO(loc);
+
+            case '?':
+                consume(1);
+                return Parser::make_IF(loc);
+
+            case '=':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_IS(loc);
+                }
+
+                consume(1);
+                return Parser::make_EQ(loc);
+
+            case '+':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_ADDEQ(loc);
+                }
+                if (NEXT == '+')
+                {
+                    consume(2);
+                    return Parser::make_INC(loc);
+                }
+
+                consume(1);
+                return Parser::make_ADD(loc);
+
+            case '-':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_SUBEQ(loc);
+                }
+                if (NEXT == '-')
+                {
+                    consume(2);
+                    return Parser::make_DEC(loc);
+                }
+                // Negative number
+                if (isDigit(NEXT))
+                    return number(p, end);
+
+                consume(1);
+                return Parser::make_SUB(loc);
+
+            case '*':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_MULEQ(loc);
+                }
+
+                consume(1);
+                return Parser::make_MUL(loc);
+
+            case '/':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_DIVEQ(loc);
+                }
+
+                consume(1);
+                return Parser::make_DIV(loc);
+
+            case '<':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_LEQ(loc);
+                }
+
+                consume(1);
+                return Parser::make_LESS(loc);
+
+            case '>':
+                if (NEXT == '=')
+                {
+                    consume(2);
+                    return Parser::make_AEQ(loc);
+                }
+
+                consume(1);
+                return Parser::make_ABOV(loc);
+
+            case '.':
+                if (end - p >= 3 && p[1] == '.' && p[2] == '.')
+                {
+                    consume(3);
+                    return Parser::make_ELLIPSIS(loc);
+                }
+
+                consume(1);
+                return Parser::make_PERIOD(loc);
+
+            case '(':
+                consume(1);
+                return Parser::make_PAR_BEGIN(loc);
+
+            case ')':
+                consume(1);
+                return Parser::make_PAR_END(loc);
+
+            case '[':
+                consume(1);
+                return Parser::make_BRACKET_BEGIN(loc);
+
+            case ']':
+                consume(1);
+                return Parser::make_BRACKET_END(loc);
+
+            case ',':
+                consume(1);
+                return Parser::make_COMMA(loc);
+
+            case ':':
+                consume(1);
+                return Parser::make_COLON(loc);
+
+            case ';':
+                consume(1);
+                return Parser::make_TERMINATE(loc);
+
+            default:
+                if (isDigit(C))
+                    return number(p, end);
+
+                if (isLetter(C))
+                    return word(p, end);
+            }
+
+            // Invalid token
+            consume(1);
+            compiler.generateError(std::string("Invalid token : ") + C,
+                ErrorInfo(module, loc.begin.line, loc.begin.column), "Token");
+        }
+    }
+
+    Parser::symbol_type Scanner::number(const char *p, const char *end)
+    {
+        const char *q = *p == '-' ? p + 1 : p;
+
+        while (q != end && isDigit(*q))
+            ++q;
+
+        // Float
+        if (q != end && *q == '.')
+        {
+            ++q;
+            while (q != end && isDigit(*q))
+                ++q;
+
+            consume(q - p);
+            return Parser::make_NUM(string(p, q), loc);
+        }
+
+        consume(q - p);
+        return Parser::make_INT(string(p, q), loc);
+    }
+
+    Parser::symbol_type Scanner::word(const char *p, const char *end)
+    {
+        const char *q = p + 1;
+
+        while (q != end && (isLetter(*q) || isDigit(*q) || *q == '_'))
+            ++q;
+
+        const size_t LEN = q - p;
+        consume(LEN);
+
+        // Keywords have the priority over identifiers
+        switch (LEN)
+        {
+        case 2:
+            if (memcmp(p, "no", 2) == 0)
+                return Parser::make_BOOL("no", loc);
+            if (memcmp(p, "or", 2) == 0)
+                return Parser::make_OR(loc);
+            if (memcmp(p, "to", 2) == 0)
+                return Parser::make_TO(loc);
+            break;
+
+        case 3:
+            if (memcmp(p, "yes", 3) == 0)
+                return Parser::make_BOOL("yes", loc);
+            if (memcmp(p, "for", 3) == 0)
+                return Parser::make_FOR(loc);
+            if (memcmp(p, "use", 3) == 0)
+                return Parser::make_USE(loc);
+            if (memcmp(p, "obj", 3) == 0)
+                return Parser::make_OBJ(loc);
+            if (memcmp(p, "ret", 3) == 0)
+                return Parser::make_RET(loc);
+            if (memcmp(p, "soa", 3) == 0)
+                return Parser::make_SOA(loc);
+            if (memcmp(p, "par", 3) == 0)
+                return Parser::make_PAR(loc);
+            break;
+
+        case 4:
+            if (memcmp(p, "cdef", 4) == 0)
+                return Parser::make_CDEF(loc);
+            if (memcmp(p, "step", 4) == 0)
+                return Parser::make_STEP(loc);
+            if (memcmp(p, "pure", 4) == 0)
+                return Parser::make_PURE(loc);
+            if (memcmp(p, "memo", 4) == 0)
+                return Parser::make_MEMO(loc);
+            if (memcmp(p, "simd", 4) == 0)
+                return Parser::make_SIMD(loc);
+            if (memcmp(p, "sync", 4) == 0)
+                return Parser::make_SYNC(loc);
+            break;
+
+        case 5:
+            if (memcmp(p, "while", 5) == 0)
+                return Parser::make_WHILE(loc);
+            if (memcmp(p, "const", 5) == 0)
+                return Parser::make_CONST(loc);
+            if (memcmp(p, "align", 5) == 0)
+                return Parser::make_ALIGN(loc);
+            if (memcmp(p, "ivdep", 5) == 0)
+                return Parser::make_IVDEP(loc);
+            if (memcmp(p, "spawn", 5) == 0)
+                return Parser::make_SPAWN(loc);
+            break;
+
+        case 6:
+            if (memcmp(p, "packed", 6) == 0)
+                return Parser::make_PACKED(loc);
+            if (memcmp(p, "unroll", 6) == 0)
+                return Parser::make_UNROLL(loc);
+            if (memcmp(p, "reduce", 6) == 0)
+                return Parser::make_REDUCE(loc);
+            break;
+
+        case 7:
+            if (memcmp(p, "noalias", 7) == 0)
+                return Parser::make_NOALIAS(loc);
+            break;
+
+        case 9:
+            if (memcmp(p, "cacheline", 9) == 0)
+                return Parser::make_CACHELINE(loc);
+            break;
+        }
+
+        return Parser::make_ID(string(p, q), loc);
+    }
+
+    void Scanner::consume(const size_t LEN)
+    {
+        updateLocation(LEN);
+        cursor += LEN;
+    }
+} // namespace up
+
+#endif
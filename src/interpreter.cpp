@@ -0,0 +1,593 @@
+#include "interpreter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+#include "compiler.h"
+#include "colors.h"
+
+using namespace std;
+
+namespace up
+{
+    namespace
+    {
+        // Maximum number of steps of an evaluation (infinite loops)
+        const long long MAX_STEPS = 10000000;
+
+        // Maximum number of nested calls
+        const size_t MAX_DEPTH = 1000;
+
+        // C math functions which can be evaluated (num arguments)
+        const map<string, float (*)(float)> MATH_FUNCTIONS = {
+            { "sinf", sinf }, { "cosf", cosf }, { "tanf", tanf },
+            { "asinf", asinf }, { "acosf", acosf }, { "atanf", atanf },
+            { "sqrtf", sqrtf }, { "expf", expf }, { "logf", logf },
+            { "log2f", log2f }, { "fabsf", fabsf },
+            { "floorf", floorf }, { "ceilf", ceilf }, { "roundf", roundf },
+        };
+
+        const map<string, float (*)(float, float)> MATH_FUNCTIONS2 = {
+            { "powf", powf }, { "atan2f", atan2f }, { "fmodf", fmodf },
+            { "fminf", fminf }, { "fmaxf", fmaxf },
+        };
+
+        // Like the int operations of C (two's complement)
+        inline int wrap(const int64_t V)
+        { return (int) (uint32_t) V; }
+    } // namespace
+
+    Value Value::fromC(const Id &TYPE, const string &LITERAL)
+    {
+        Value v;
+        v.type = TYPE;
+
+        if (TYPE == "num")
+            v.n = stof(LITERAL);
+        else
+            v.i = stoi(LITERAL);
+
+        return v;
+    }
+
+    string Value::toC() const
+    {
+        if (type != "num")
+            return to_string(i);
+
+        if (!isfinite(n))
+            return "";
+
+        // Enough digits to read the same float
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.9g", n);
+
+        string s = buf;
+        if (s.find_first_of(".e") == string::npos)
+            s += '.';
+
+        return s + 'f';
+    }
+
+    Value Value::to(const Id &TYPE) const
+    {
+        Value v;
+        v.type = TYPE;
+
+        if (TYPE == "num")
+            v.n = type == "num" ? n : (float) i;
+        else if (TYPE == "bool")
+            v.i = type == "num" ? n != 0 : i != 0;
+        else
+            v.i = type == "num" ? (int) n : i;
+
+        return v;
+    }
+
+    bool Interpreter::evaluate(Expression *expr, const map<string, Value> &VARIABLES, Value &result)
+    {
+        frames.push_back({ VARIABLES });
+
+        bool ok = eval(expr, result);
+
+        frames.pop_back();
+
+        return ok;
+    }
+
+    bool Interpreter::isConstant(Compiler *compiler, Expression *expr)
+    {
+        if (auto literal = dynamic_cast<Literal*>(expr))
+            return literal->type != "str";
+
+        if (auto usage = dynamic_cast<VariableUsage*>(expr))
+        {
+            Constant *c = compiler->getConstant(usage->id);
+
+            // A local variable may have the name of a constant
+            return c && c->variable.count == 0 && compiler->getVar(usage->id) == &c->variable;
+        }
+
+        if (auto index = dynamic_cast<Index*>(expr))
+        {
+            Constant *c = compiler->getConstant(index->id);
+
+            return c && compiler->getVar(index->id) == &c->variable && isConstant(compiler, index->index);
+        }
+
+        if (auto op = dynamic_cast<BinaryOperation*>(expr))
+            return isConstant(compiler, op->first) && isConstant(compiler, op->second);
+
+        return false;
+    }
+
+    bool Interpreter::eval(Expression *expr, Value &result)
+    {
+        if (!step(expr->info))
+            return false;
+
+        if (auto literal = dynamic_cast<Literal*>(expr))
+        {
+            if (literal->type == "str")
+                return fail("Strings can't be evaluated at compile time", expr->info);
+
+            result = Value::fromC(literal->type, literal->toString());
+
+            return true;
+        }
+
+        if (auto usage = dynamic_cast<VariableUsage*>(expr))
+        {
+            const string NAME = usage->id.toC();
+
+            if (Value *v = local(NAME))
+            {
+                result = *v;
+                return true;
+            }
+
+            Constant *c = compiler->getConstant(usage->id);
+            if (!c || c->variable.count > 0)
+                return fail("The variable '" + AS_BLUE(usage->id.toUp()) +
+                    "' can't be used at compile time", expr->info);
+
+            if (!c->evaluate(compiler))
+                return false;
+
+            result = Value::fromC(c->variable.type, c->values[0]);
+
+            return true;
+        }
+
+        if (auto index = dynamic_cast<Index*>(expr))
+        {
+            Constant *c = compiler->getConstant(index->id);
+            if (!c)
+                return fail("The table '" + AS_BLUE(index->id.toUp()) +
+                    "' can't be used at compile time", expr->info);
+
+            Value i;
+            if (!eval(index->index, i) || !c->evaluate(compiler))
+                return false;
+
+            if (i.i < 0 || i.i >= c->variable.count)
+                return fail("The index " + to_string(i.i) + " is out of the table '" +
+                    AS_BLUE(index->id.toUp()) + "' (" + to_string(c->variable.count) + " values)", expr->info);
+
+            result = Value::fromC(c->variable.type, c->values[i.i]);
+
+            return true;
+        }
+
+        if (auto op = dynamic_cast<UnaryOperation*>(expr))
+        {
+            Value *v = local(op->id.toC());
+            if (!v)
+                return fail("The variable '" + AS_BLUE(op->id.toUp()) +
+                    "' can't be modified at compile time", expr->info);
+
+            const int DELTA = op->operand == "++" ? 1 : -1;
+            Value old = *v;
+
+            if (v->type == "num")
+                v->n += DELTA;
+            else
+                v->i = wrap((int64_t) v->i + DELTA);
+
+            result = op->prefix ? *v : old;
+
+            return true;
+        }
+
+        if (auto op = dynamic_cast<BinaryOperation*>(expr))
+            return binary(op, result);
+
+        if (auto c = dynamic_cast<Call*>(expr))
+            return call(c, result);
+
+        return fail("This expression can't be evaluated at compile time", expr->info);
+    }
+
+    bool Interpreter::binary(BinaryOperation *op, Value &result)
+    {
+        Value a, b;
+        if (!eval(op->first, a) || !eval(op->second, b))
+            return false;
+
+        const string &OP = op->operand;
+
+        // Comparisons
+        if (op->condition)
+        {
+            bool r;
+            if (a.type == "num")
+            {
+                r = OP == "==" ? a.n == b.n : OP == "<=" ? a.n <= b.n : OP == "<" ? a.n < b.n :
+                    OP == ">=" ? a.n >= b.n : a.n > b.n;
+            }
+            else
+            {
+                r = OP == "==" ? a.i == b.i : OP == "<=" ? a.i <= b.i : OP == "<" ? a.i < b.i :
+                    OP == ">=" ? a.i >= b.i : a.i > b.i;
+            }
+
+            result.type = Id("bool");
+            result.i = r;
+
+            return true;
+        }
+
+        result.type = a.type;
+
+        if (a.type == "num")
+        {
+            if (OP == "+")
+                result.n = a.n + b.n;
+            else if (OP == "-")
+                result.n = a.n - b.n;
+            else if (OP == "*")
+                result.n = a.n * b.n;
+            else if (OP == "/")
+                result.n = a.n / b.n;
+            else
+                return fail("The operator '" + AS_BLUE(OP) + "' can't be evaluated on '" +
+                    AS_BLUE("num") + "' values", op->info);
+
+            return true;
+        }
+
+        if ((OP == "/" || OP == "%") && b.i == 0)
+            return fail("Division by zero", op->info);
+
+        if (OP == "+")
+            result.i = wrap((int64_t) a.i + b.i);
+        else if (OP == "-")
+            result.i = wrap((int64_t) a.i - b.i);
+        else if (OP == "*")
+            result.i = wrap((int64_t) a.i * b.i);
+        else if (OP == "/")
+            result.i = wrap((int64_t) a.i / b.i);
+        else
+            result.i = wrap((int64_t) a.i % b.i);
+
+        return true;
+    }
+
+    bool Interpreter::call(Call *c, Value &result)
+    {
+        Function *f = c->function;
+
+        vector<Value> args;
+        for (auto a : c->args)
+        {
+            Value v;
+            if (!eval(a, v))
+                return false;
+
+            args.push_back(v);
+        }
+
+        // C math library
+        if (f->isCDef)
+        {
+            const string NAME = f->cName();
+            auto math = MATH_FUNCTIONS.find(NAME);
+            auto math2 = MATH_FUNCTIONS2.find(NAME);
+
+            result.type = Id("num");
+
+            if (math != MATH_FUNCTIONS.end() && args.size() == 1 && args[0].type == "num")
+                result.n = math->second(args[0].n);
+            else if (math2 != MATH_FUNCTIONS2.end() && args.size() == 2 &&
+                args[0].type == "num" && args[1].type == "num")
+                result.n = math2->second(args[0].n, args[1].n);
+            else
+                return fail("The C function '" + AS_BLUE(f->id.toUp()) +
+                    "' can't be called at compile time", c->info);
+
+            return true;
+        }
+
+        auto upFunc = dynamic_cast<UpFunction*>(f);
+        if (!upFunc || f->purity == Purity::Impure)
+            return fail("The function '" + AS_BLUE(f->id.toUp()) +
+                "' can't be called at compile time because it has side effects", c->info);
+
+        if (frames.size() >= MAX_DEPTH)
+            return fail("Too many nested calls at compile time", c->info);
+
+        // Arguments
+        map<string, Value> frame;
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            if (args[i].type != "int" && args[i].type != "num" && args[i].type != "bool")
+                return fail("Only '" + AS_BLUE("int") + "', '" + AS_BLUE("num") + "' and '" +
+                    AS_BLUE("bool") + "' values can be used at compile time", c->info);
+
+            frame[f->args[i]->id.toC()] = args[i];
+        }
+
+        frames.push_back({ frame });
+        Flow flow = executeBlock(upFunc->body, result);
+        frames.pop_back();
+
+        if (flow == Flow::Error)
+            return false;
+
+        if (flow != Flow::Return)
+            return fail("The function '" + AS_BLUE(f->id.toUp()) +
+                "' doesn't return a value", c->info);
+
+        result = result.to(f->type);
+
+        return true;
+    }
+
+    Interpreter::Flow Interpreter::execute(Statement *s, Value &result)
+    {
+        if (!step(s->info))
+            return Flow::Error;
+
+        Value v;
+
+        if (auto e = dynamic_cast<ExpressionStatement*>(s))
+            return eval(e->expr, v) ? Flow::Next : Flow::Error;
+
+        if (auto decl = dynamic_cast<VariableDeclaration*>(s))
+        {
+            const Id TYPE = decl->variable ? decl->variable->type : decl->type;
+
+            if (decl->count > 0)
+            {
+                fail("The table '" + AS_BLUE(decl->id.toUp()) + "' can't be declared at compile time", s->info);
+                return Flow::Error;
+            }
+
+            v.type = TYPE;
+            if (decl->expr && !eval(decl->expr, v))
+                return Flow::Error;
+
+            frames.back().back()[decl->id.toC()] = v.to(TYPE);
+
+            return Flow::Next;
+        }
+
+        if (auto assign = dynamic_cast<VariableAssignement*>(s))
+        {
+            Value *var = local(assign->id.toC());
+            if (!var)
+            {
+                fail("The variable '" + AS_BLUE(assign->id.toUp()) +
+                    "' can't be modified at compile time", s->info);
+                return Flow::Error;
+            }
+
+            if (!eval(assign->expr, v))
+                return Flow::Error;
+
+            if (assign->operand == "=")
+            {
+                *var = v;
+                return Flow::Next;
+            }
+
+            // a += b is a = a + b
+            const string OP = assign->operand.substr(0, 1);
+            if (var->type == "num")
+            {
+                if (OP == "+")
+                    var->n += v.n;
+                else if (OP == "-")
+                    var->n -= v.n;
+                else if (OP == "*")
+                    var->n *= v.n;
+                else if (OP == "/")
+                    var->n /= v.n;
+                else
+                {
+                    fail("The operator '" + AS_BLUE(assign->operand) + "' can't be evaluated on '" +
+                        AS_BLUE("num") + "' values", s->info);
+                    return Flow::Error;
+                }
+
+                return Flow::Next;
+            }
+
+            if ((OP == "/" || OP == "%") && v.i == 0)
+            {
+                fail("Division by zero", s->info);
+                return Flow::Error;
+            }
+
+            var->i = wrap(OP == "+" ? (int64_t) var->i + v.i : OP == "-" ? (int64_t) var->i - v.i :
+                OP == "*" ? (int64_t) var->i * v.i : OP == "/" ? (int64_t) var->i / v.i :
+                (int64_t) var->i % v.i);
+
+            return Flow::Next;
+        }
+
+        if (auto ret = dynamic_cast<Return*>(s))
+        {
+            if (ret->expr && !eval(ret->expr, result))
+                return Flow::Error;
+
+            return Flow::Return;
+        }
+
+        if (auto seq = dynamic_cast<ConditionSequence*>(s))
+        {
+            for (auto c : seq->controls)
+            {
+                if (auto o = dynamic_cast<OrStatement*>(c))
+                    return executeBlock(o->content, result);
+
+                auto control = (ControlStatement*) c;
+                if (!eval(control->condition, v))
+                    return Flow::Error;
+
+                if (v.i)
+                    return executeBlock(control->content, result);
+            }
+
+            return Flow::Next;
+        }
+
+        // While
+        if (auto loop = dynamic_cast<ControlStatement*>(s))
+        {
+            while (true)
+            {
+                if (!eval(loop->condition, v))
+                    return Flow::Error;
+
+                if (!v.i)
+                    return Flow::Next;
+
+                Flow flow = executeBlock(loop->content, result);
+                if (flow != Flow::Next)
+                    return flow;
+            }
+        }
+
+        if (auto loop = dynamic_cast<ForStatement*>(s))
+            return executeFor(loop, result);
+
+        fail("This statement can't be executed at compile time", s->info);
+
+        return Flow::Error;
+    }
+
+    Interpreter::Flow Interpreter::executeBlock(Block *block, Value &result)
+    {
+        // The variables of the block are removed at its end
+        frames.back().emplace_back();
+
+        Flow flow = Flow::Next;
+        for (auto s : block->content)
+        {
+            flow = execute(s, result);
+
+            if (flow != Flow::Next)
+                break;
+        }
+
+        frames.back().pop_back();
+
+        return flow;
+    }
+
+    Interpreter::Flow Interpreter::executeFor(ForStatement *loop, Value &result)
+    {
+        Value begin, end, step;
+
+        if (!eval(loop->begin, begin) || !eval(loop->end, end))
+            return Flow::Error;
+
+        // Like the C loop (see ForStatement::toString)
+        if (loop->step)
+        {
+            if (!eval(loop->step, step))
+                return Flow::Error;
+        }
+        else
+        {
+            const bool ASCENDING = loop->direction > 0 ||
+                (loop->direction == 0 && (begin.type == "num" ? begin.n <= end.n : begin.i <= end.i));
+
+            step.type = Id("int");
+            step.i = ASCENDING ? 1 : -1;
+        }
+
+        const Id TYPE = loop->iteratorType;
+        const string NAME = loop->varId.toC();
+        begin = begin.to(TYPE);
+        end = end.to(TYPE);
+        step = step.to(TYPE);
+
+        // The iterator is declared in the scope of the loop (for (int i = ...))
+        // * frames.back() is read again after each call (frames can grow)
+        frames.back().emplace_back();
+        frames.back().back()[NAME] = begin;
+
+        Flow flow = Flow::Next;
+        while (true)
+        {
+            const Value I = frames.back().back()[NAME];
+            const bool ASCENDING = TYPE == "num" ? step.n > 0 : step.i > 0;
+            const bool INSIDE = TYPE == "num" ?
+                (ASCENDING ? I.n < end.n : I.n > end.n) :
+                (ASCENDING ? I.i < end.i : I.i > end.i);
+
+            if (!INSIDE)
+                break;
+
+            flow = executeBlock(loop->content, result);
+            if (flow != Flow::Next)
+                break;
+
+            Value &i = frames.back().back()[NAME];
+            if (TYPE == "num")
+                i.n += step.n;
+            else
+                i.i = wrap((int64_t) i.i + step.i);
+        }
+
+        frames.back().pop_back();
+
+        return flow;
+    }
+
+    Value *Interpreter::local(const string &NAME)
+    {
+        auto &scopes = frames.back();
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+        {
+            auto v = scope->find(NAME);
+            if (v != scope->end())
+                return &v->second;
+        }
+
+        return nullptr;
+    }
+
+    bool Interpreter::step(const ErrorInfo &INFO)
+    {
+        if (++steps <= MAX_STEPS)
+            return true;
+
+        // Reported once
+        if (steps == MAX_STEPS + 1)
+            compiler->generateError("The evaluation at compile time takes too long (more than " +
+                to_string(MAX_STEPS) + " steps)", INFO);
+
+        return false;
+    }
+
+    bool Interpreter::fail(const string &MSG, const ErrorInfo &INFO)
+    {
+        compiler->generateError(MSG, INFO);
+
+        return false;
+    }
+} // namespace up
@@ -0,0 +1,87 @@
+#pragma once
+
+// Evaluates expressions at compile time (values of constants)
+// The values are int, num or bool, the expressions can call pure
+// up functions (their statements are executed) and functions of
+// the C math library (sinf, sqrtf...)
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "components.h"
+
+namespace up
+{
+    class Compiler;
+
+    // Result of an expression
+    struct Value
+    {
+        // Parses the C literal of a value of type TYPE
+        static Value fromC(const Id &TYPE, const std::string &LITERAL);
+
+        // Returns the C literal (empty if the num is not finite)
+        std::string toC() const;
+
+        // Returns this value converted to TYPE (int, num or bool)
+        Value to(const Id &TYPE) const;
+
+        // Up type (int, num or bool)
+        Id type;
+        // int and bool (0 or 1)
+        int i = 0;
+        // num (a float like in C)
+        float n = 0;
+    };
+
+    class Interpreter
+    {
+    public:
+        Interpreter(Compiler *compiler)
+            : compiler(compiler)
+        {}
+
+    public:
+        // Evaluates the processed expression with VARIABLES (C name -> value)
+        // Returns false if it can't be evaluated (an error is generated)
+        bool evaluate(Expression *expr, const std::map<std::string, Value> &VARIABLES, Value &result);
+
+        // Whether the processed expression uses only literals and constants (no call)
+        static bool isConstant(Compiler *compiler, Expression *expr);
+
+    private:
+        // What to do after a statement
+        enum class Flow { Next, Return, Error };
+
+        bool eval(Expression *expr, Value &result);
+        bool call(Call *c, Value &result);
+        bool binary(BinaryOperation *op, Value &result);
+
+        // result is the returned value if Flow::Return
+        Flow execute(Statement *s, Value &result);
+        Flow executeBlock(Block *block, Value &result);
+        Flow executeFor(ForStatement *loop, Value &result);
+
+        // Returns the variable of the innermost block of the current function
+        // which declares NAME
+        // !!! Can return nullptr
+        Value *local(const std::string &NAME);
+
+        // Counts a step and returns false if the evaluation takes too long
+        bool step(const ErrorInfo &INFO);
+
+        // Generates an error and returns false
+        bool fail(const std::string &MSG, const ErrorInfo &INFO);
+
+    private:
+        Compiler *compiler;
+
+        // Variables of each called function, one scope per block
+        // like in the generated C (C name -> value)
+        std::vector<std::vector<std::map<std::string, Value>>> frames;
+
+        // Number of evaluated statements and calls
+        long long steps = 0;
+    };
+} // namespace up
@@ -0,0 +1,180 @@
+#include "lazy.h"
+
+#include <regex>
+
+using namespace std;
+
+namespace up
+{
+    namespace
+    {
+        // A line of the source
+        struct Line
+        {
+            // Byte range (next is the beginning of the next line)
+            size_t begin, next;
+            // The code without comments
+            string code;
+            // Whether the line begins within a C section
+            bool inC;
+            // Whether the line begins with a tab or a space
+            bool indented;
+
+            // No code (comments and spaces only)
+            inline bool empty() const
+            { return !inC && code.find_first_not_of(" \t") == string::npos; }
+        };
+
+        // Splits SRC in lines
+        vector<Line> splitLines(const string &SRC)
+        {
+            vector<Line> lines;
+            bool inC = false;
+
+            for (size_t i = 0; i < SRC.size(); )
+            {
+                Line l;
+                l.begin = i;
+                l.inC = inC;
+                l.indented = SRC[i] == '\t' || SRC[i] == ' ';
+
+                for ( ; i < SRC.size() && SRC[i] != '\n'; ++i)
+                {
+                    const char C = SRC[i];
+                    const char NEXT = i + 1 < SRC.size() ? SRC[i + 1] : '\0';
+
+                    if (inC)
+                    {
+                        // End of the C section
+                        if (C == '%' && NEXT == '}')
+                        {
+                            inC = false;
+                            ++i;
+                        }
+                    }
+                    // String
+                    else if (C == '\'')
+                    {
+                        l.code += C;
+                        for (++i; i < SRC.size() && SRC[i] != '\n' && SRC[i] != '\''; ++i)
+                        {
+                            if (SRC[i] == '\\' && i + 1 < SRC.size() && SRC[i + 1] == '\'')
+                                l.code += SRC[i++];
+
+                            l.code += SRC[i];
+                        }
+
+                        if (i < SRC.size() && SRC[i] == '\'')
+                            l.code += '\'';
+                        else
+                            --i;
+                    }
+                    // Comment
+                    else if (C == '#')
+                    {
+                        while (i + 1 < SRC.size() && SRC[i + 1] != '\n')
+                            ++i;
+                    }
+                    // Beginning of a C section
+                    else if (C == '%' && NEXT == '{')
+                    {
+                        inC = true;
+                        l.code += "%{";
+                        ++i;
+                    }
+                    else
+                        l.code += C;
+                }
+
+                // Skip the new line
+                if (i < SRC.size())
+                    ++i;
+
+                l.next = i;
+                lines.push_back(l);
+            }
+
+            return lines;
+        }
+
+        // Whether the line is the header of an up function
+        // For example :
+        // int add(int a, int b)
+        // pure memo(64) int add(int a, int b)
+        bool isFunctionHeader(const Line &LINE)
+        {
+            static const regex HEADER("^(?:(?:pure|const|memo(?:[ \t]*\\([^)]*\\))?)[ \t]+)*([a-zA-Z][a-zA-Z0-9_.]*)(?:\\[[^()]*\\])?[ \t]+[a-zA-Z][a-zA-Z0-9_.]*[ \t]*\\(.*\\)[ \t]*$");
+            static const vector<string> KEYWORDS = { "cdef", "obj", "use", "ret", "for", "while", "or" };
+
+            if (LINE.inC || LINE.indented)
+                return false;
+
+            smatch match;
+            if (!regex_match(LINE.code, match, HEADER))
+                return false;
+
+            for (auto &keyword : KEYWORDS)
+                if (match[1] == keyword)
+                    return false;
+
+            return true;
+        }
+    } // namespace
+
+    string deferBodies(const Module &MOD, const string &SRC, vector<LazyBody*> &bodies)
+    {
+        const vector<Line> LINES = splitLines(SRC);
+        string result;
+        // Beginning of the source not yet copied
+        size_t copied = 0;
+
+        for (size_t h = 0; h < LINES.size(); ++h)
+        {
+            if (!isFunctionHeader(LINES[h]))
+                continue;
+
+            // Find the last line of the body (indented or within a C section)
+            size_t last = h;
+            for (size_t j = h + 1; j < LINES.size(); ++j)
+            {
+                if (LINES[j].empty())
+                    continue;
+
+                if (!LINES[j].indented && !LINES[j].inC)
+                    break;
+
+                last = j;
+            }
+
+            // No body
+            if (last == h)
+                continue;
+
+            const size_t BEGIN = LINES[h + 1].begin;
+            const size_t END = LINES[last].next;
+
+            // Indentation of the first line of the body (a tab or 4 spaces)
+            int indent = 0;
+            for (size_t i = BEGIN; i < END && (SRC[i] == '\t' || SRC.compare(i, 4, "    ") == 0);
+                i += SRC[i] == '\t' ? 1 : 4)
+                ++indent;
+
+            // Copy until the end of the header
+            result += SRC.substr(copied, BEGIN - copied);
+
+            // Placeholder and empty lines to keep the line numbers
+            result += "\t%[" + to_string(bodies.size()) + "]\n";
+            result += string(last - h - 1, '\n');
+
+            bodies.push_back(new LazyBody(MOD, SRC.substr(LINES[h].begin, END - LINES[h].begin),
+                h + 1, indent, BEGIN, END));
+
+            copied = END;
+            h = last;
+        }
+
+        result += SRC.substr(copied);
+
+        return result;
+    }
+} // namespace up
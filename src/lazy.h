@@ -0,0 +1,39 @@
+#pragma once
+
+// Lazy parsing of function bodies for imported modules
+// The body of a function is replaced by a placeholder %[i] and is
+// parsed only when the function is called
+
+#include <string>
+#include <vector>
+
+#include "module.h"
+
+namespace up
+{
+    // The source of a function which is not parsed yet
+    struct LazyBody
+    {
+        LazyBody(const Module &MOD, const std::string &TEXT, const int LINE, const int INDENT,
+            const size_t BEGIN, const size_t END)
+            : module(MOD), text(TEXT), line(LINE), indent(INDENT), begin(BEGIN), end(END)
+        {}
+
+        // The module where the function is declared
+        Module module;
+        // The header line followed by the body
+        std::string text;
+        // The line of the header
+        int line;
+        // Indentation level of the body
+        int indent;
+        // Byte range of the body within the module
+        size_t begin, end;
+    };
+
+    // Replaces the body of each function of SRC by a placeholder
+    // (the number of lines doesn't change)
+    // * The placeholder %[i] refers to bodies[i]
+    // * New bodies are appended to bodies
+    std::string deferBodies(const Module &MOD, const std::string &SRC, std::vector<LazyBody*> &bodies);
+} // namespace up
@@ -2,11 +2,18 @@
 #include <fstream>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+#include <chrono>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
 
 #include "scanner.h"
 #include "compiler.h"
 #include "parser.hpp"
 #include "global.h"
+#include "upm.h"
+#include "server.h"
 
 using namespace up;
 using namespace std;
@@ -48,8 +55,8 @@ void compileToBinFile(const string ENTRY, const string OUT, Compiler &compiler,
     // Up to C
     compileToCFile(ENTRY, C_FILE, compiler, ret);
     
-    // C to Bin
-    string cmd = "gcc -o ";
+    // C to Bin (simd and par loops are OpenMP pragmas, spawned calls use threads)
+    string cmd = "gcc" + compiler.gccFlags + " -o ";
     cmd += OUT;
     cmd += " " + C_FILE;
     system(cmd.c_str());
@@ -58,12 +65,279 @@ void compileToBinFile(const string ENTRY, const string OUT, Compiler &compiler,
     remove(C_FILE.c_str());
 }
 
+// Runs the shell commands CMDS with at most JOBS processes at the same time
+// Returns the number of failed commands
+int runJobs(const vector<string> &CMDS, const int JOBS)
+{
+    int failed = 0;
+    int running = 0;
+
+    for (size_t i = 0; i < CMDS.size() || running > 0; )
+    {
+        // Start a new job
+        if (i < CMDS.size() && running < JOBS)
+        {
+            pid_t pid = fork();
+
+            if (pid == 0)
+            {
+                execl("/bin/sh", "sh", "-c", CMDS[i].c_str(), (char*) nullptr);
+                _exit(127);
+            }
+
+            if (pid < 0)
+                ++failed;
+            else
+                ++running;
+
+            ++i;
+            continue;
+        }
+
+        // Wait for a job to end
+        int status;
+        if (wait(&status) < 0)
+            break;
+
+        --running;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ++failed;
+    }
+
+    return failed;
+}
+
+// Compiles each entry to OUT_DIR/<name>.c and then
+// to the binary OUT_DIR/<name> (using gcc with JOBS processes)
+// * Imported modules are parsed only once
+void compileBatch(const vector<string> &ENTRIES, string outDir, const int JOBS, Compiler &compiler, int &ret)
+{
+    if (!outDir.empty() && outDir.back() != '/')
+        outDir += '/';
+
+    // Names of the outputs
+    vector<string> names;
+    for (auto entry : ENTRIES)
+    {
+        size_t slash = entry.find_last_of('/');
+        string name = slash == string::npos ? entry : entry.substr(slash + 1);
+
+        if (name.size() > 3 && name.substr(name.size() - 3) == ".up")
+            name = name.substr(0, name.size() - 3);
+
+        for (auto other : names)
+            if (other == name)
+            {
+                cerr << "Two entries have the same name '" << name << "'\n";
+                ret = -1;
+                return;
+            }
+
+        names.push_back(name);
+    }
+
+    // The directory may already exist
+    mkdir(outDir.c_str(), 0755);
+
+    // Share declarations of imported modules
+    compiler.cacheModules = true;
+
+    // Up to C
+    vector<string> cmds;
+    int failed = 0;
+    for (size_t i = 0; i < ENTRIES.size(); ++i)
+    {
+        const string C_FILE = outDir + names[i] + ".c";
+        int entryRet = 0;
+
+        compileToCFile(ENTRIES[i], C_FILE, compiler, entryRet);
+
+        if (entryRet)
+        {
+            cerr << "Can't compile '" << ENTRIES[i] << "'\n";
+            ++failed;
+            continue;
+        }
+
+        cmds.push_back("gcc" + compiler.gccFlags + " -o " + outDir + names[i] + " " + C_FILE);
+    }
+
+    // C to Bin
+    failed += runJobs(cmds, JOBS);
+
+    if (failed)
+    {
+        cerr << failed << " / " << ENTRIES.size() << " entries failed\n";
+        ret = 1;
+    }
+}
+
 void printHelp()
 {
     cout << "Usage :\n";
     cout << "up <entry.up>\t\tPrints the C output to stdout\n";
     cout << "up <entry.up> <out.c>\tWrites the C output to out.c\n";
     cout << "up <entry.up> <out>\tCompiles to the binary out (using gcc)\n";
+    cout << "up --check <entry.up>\tOnly prints errors (no C output)\n";
+    cout << "up --layout-report <entry.up>\n\t\t\tPrints the sizes and the padding of the objects with fields\n";
+    cout << "up --bounds-report <entry.up>\n\t\t\tPrints the checked accesses and the checks removed by loops\n";
+    cout << "up --batch <entries.up...> -o <dir> [-j <jobs>]\n\t\t\tCompiles each entry to dir/<entry>.c and dir/<entry>\n";
+    cout << "up --lazy ...\t\tParses bodies of imported functions only if they are called\n";
+    cout << "up --memo-stats ...\tMemoized functions print their cache hits and misses at exit\n";
+    cout << "up --max-specializations <n> ...\n\t\t\tCopies a function at most n times for calls with literal arguments (4 by default, 0 to disable)\n";
+    cout << "up --serve <socket>\tCompiles entries on requests (imports stay in memory)\n";
+    cout << "up --connect <socket> <entry.up>\n\t\t\tPrints the C output compiled by the server\n";
+    cout << "up --dump-tokens <file.up>\tPrints the tokens of the file\n";
+    cout << "up --lex-bench <file.up>\tPrints the throughput of the lexer\n";
+    cout << "up --emit-module <mod.up> [<out.upm>]\n\t\t\tPrecompiles the module (to mod.upm by default)\n";
+}
+
+// Parses the arguments of --batch and compiles
+int batchMain(int argc, char **argv, Compiler &compiler)
+{
+    vector<string> entries;
+    string outDir;
+    int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outDir = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            jobs = atoi(argv[++i]);
+        else
+            entries.push_back(argv[i]);
+    }
+
+    if (entries.empty() || outDir.empty() || jobs < 1)
+    {
+        printHelp();
+
+        return -1;
+    }
+
+    int ret = 0;
+    compileBatch(entries, outDir, jobs, compiler, ret);
+
+    return ret;
+}
+
+// Sends the entry to the server listening on SOCKET_PATH
+int connectMain(const string &SOCKET_PATH, const string &ENTRY)
+{
+    string entry = ENTRY;
+
+    // The server may run in another folder
+    if (!entry.empty() && entry[0] != '/')
+    {
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)))
+            entry = string(cwd) + "/" + entry;
+    }
+
+    string response;
+    int ret = sendRequest(SOCKET_PATH, "compile " + entry, response);
+
+    if (ret < 0)
+        cerr << "Can't connect to the server '" << SOCKET_PATH << "'\n";
+    else if (ret == 0)
+        cout << response;
+    else
+        cerr << response;
+
+    return ret;
+}
+
+// Prints the tokens of the file (to compare lexers)
+// Format : line:column token [value]
+int dumpTokens(const string &PATH, Compiler &compiler)
+{
+    string content;
+    if (!compiler.fs.read(PATH, content))
+    {
+        cerr << "Can't open '" << PATH << "'\n";
+        return -1;
+    }
+
+    // Token errors are printed with tokens
+    compiler.errorStream = &cout;
+
+    Scanner scanner(compiler);
+    scanner.beginParse(Module(Id(PATH), true), content);
+
+    while (true)
+    {
+        auto tok = scanner.next();
+
+        cout << scanner.loc.begin.line << ':' << scanner.loc.begin.column << ' ' << tok.token();
+
+        switch (tok.token())
+        {
+        case Parser::token::TOKEN_INDENT_UPDT:
+        case Parser::token::TOKEN_LAZY:
+            cout << ' ' << tok.value.as<int>();
+            break;
+
+        case Parser::token::TOKEN_ID:
+        case Parser::token::TOKEN_INT:
+        case Parser::token::TOKEN_NUM:
+        case Parser::token::TOKEN_BOOL:
+        case Parser::token::TOKEN_STR:
+        case Parser::token::TOKEN_CCODE:
+            cout << ' ' << tok.value.as<string>();
+            break;
+
+        default:
+            break;
+        }
+
+        cout << '\n';
+
+        if (tok.token() == Parser::token::TOKEN_END)
+            break;
+    }
+
+    scanner.endParse();
+
+    return compiler.diagnostics.empty() ? 0 : 1;
+}
+
+// Prints the throughput of the lexer on the file
+int lexBench(const string &PATH, Compiler &compiler)
+{
+    string content;
+    if (!compiler.fs.read(PATH, content) || content.empty())
+    {
+        cerr << "Can't open '" << PATH << "'\n";
+        return -1;
+    }
+
+    compiler.errorStream = nullptr;
+
+    Scanner scanner(compiler);
+    size_t bytes = 0;
+    size_t tokens = 0;
+
+    auto begin = chrono::steady_clock::now();
+
+    // Scan at least 256 MB
+    while (bytes < (256 << 20))
+    {
+        scanner.beginParse(Module(Id(PATH), true), content);
+
+        while (scanner.next().token() != Parser::token::TOKEN_END)
+            ++tokens;
+
+        scanner.endParse();
+        bytes += content.size();
+    }
+
+    chrono::duration<double> time = chrono::steady_clock::now() - begin;
+
+    cout << bytes / time.count() / (1 << 20) << " MB/s, " <<
+        tokens / time.count() / 1e6 << " M tokens/s\n";
+
+    return 0;
 }
 
 int main(int argc, char **argv)
@@ -75,8 +349,84 @@ int main(int argc, char **argv)
 
     Compiler compiler;
 
+    // Options before the command
+    while (argc >= 2)
+    {
+        // Lazy parsing of imported modules
+        if (strcmp(argv[1], "--lazy") == 0)
+            compiler.lazyImports = true;
+        // Statistics of memoized functions
+        else if (strcmp(argv[1], "--memo-stats") == 0)
+            compiler.memoStats = true;
+        // Copies of functions for literal arguments
+        else if (strcmp(argv[1], "--max-specializations") == 0 && argc >= 3)
+        {
+            compiler.maxSpecializations = atoi(argv[2]);
+            --argc;
+            ++argv;
+        }
+        else
+            break;
+
+        --argc;
+        ++argv;
+    }
+
+    // Multiple entries
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+        return batchMain(argc, argv, compiler);
+
+    // Resident compiler
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0)
+        return serve(compiler, argv[2]);
+
+    // Compile with the resident compiler
+    if (argc == 4 && strcmp(argv[1], "--connect") == 0)
+        return connectMain(argv[2], argv[3]);
+
+    // Only diagnostics
+    if (argc == 3 && strcmp(argv[1], "--check") == 0)
+    {
+        compiler.checkOnly = true;
+
+        return compiler.compile(argv[2]);
+    }
+
+    // Sizes of the generated structs
+    if (argc == 3 && strcmp(argv[1], "--layout-report") == 0)
+    {
+        compiler.checkOnly = true;
+
+        ret = compiler.compile(argv[2]);
+        if (ret == 0)
+            cout << compiler.layoutReport();
+
+        return ret;
+    }
+
+    // Bounds checks removed by the range analysis
+    if (argc == 3 && strcmp(argv[1], "--bounds-report") == 0)
+    {
+        compiler.checkOnly = true;
+
+        ret = compiler.compile(argv[2]);
+        if (ret == 0)
+            cout << compiler.boundsReport();
+
+        return ret;
+    }
+
+    // Lexer tools
+    if (argc == 3 && strcmp(argv[1], "--dump-tokens") == 0)
+        return dumpTokens(argv[2], compiler);
+    if (argc == 3 && strcmp(argv[1], "--lex-bench") == 0)
+        return lexBench(argv[2], compiler);
+
+    // Precompile a module
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "--emit-module") == 0)
+        ret = compiler.emitModule(argv[2], argc == 4 ? argv[3] : upmPath(argv[2]));
     // Output C to stdout
-    if (argc == 2)
+    else if (argc == 2)
     {
         if (strcmp(argv[1], "--help") == 0 |
             strcmp(argv[1], "-h") == 0)
@@ -27,7 +27,7 @@ namespace up
     public:
         // To use it in a set
         inline bool operator<(const Module &MOD) const
-        { return id.ids[0][0] < MOD.id.ids[0][0]; }
+        { return path() < MOD.path(); }
 
     public:
         // Can be a path : mod.file
@@ -0,0 +1,46 @@
+#pragma once
+
+// Declarations of an imported module
+
+#include <string>
+#include <vector>
+#include <tuple>
+
+#include "components.h"
+#include "types.h"
+#include "module.h"
+#include "error_info.h"
+#include "generic.h"
+
+namespace up
+{
+    // Kept between compilations to parse shared modules once
+    // and loaded from precompiled modules (.upm)
+    struct ModuleUnit
+    {
+        ~ModuleUnit();
+
+        // Functions declared within the module (owned by the unit)
+        std::vector<Function*> functions;
+        // Types declared with obj
+        std::vector<TypeDecl> types;
+        // Operators declared for these types (type, operator)
+        std::vector<std::pair<Id, std::string>> operators;
+        // Generic types (templates parsed for each instance)
+        std::vector<GenericDecl> generics;
+        // Instances of generic types used by the module (generic, type arguments),
+        // they are instantiated again by each compilation
+        std::vector<std::tuple<Id, std::vector<Id>, ErrorInfo>> instances;
+        // Constants declared within the module (owned by the unit)
+        std::vector<Constant*> constants;
+        // C sections (global scope)
+        std::string cCode;
+        // Generated C of the up functions of a precompiled module
+        // (these functions are declared as cdef in functions)
+        std::string upCode;
+        // Modules imported by this module (up, c or libc)
+        std::vector<std::pair<Module, ErrorInfo>> imports;
+        // A module with global statements can't be reused
+        bool reusable = true;
+    };
+} // namespace up
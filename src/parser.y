@@ -67,6 +67,51 @@
 	// Error but use another location
 	#define LOC_ERROR(LOC) ErrorInfo(scanner.module, LOC.begin.line, LOC.begin.column)
 
+	// Type of an instance or a table (the arguments are deleted)
+	static inline TypeName genericType(Compiler &compiler, const pair<Id, vector<Expression*>> &SUBSCRIPT,
+		const ErrorInfo &INFO)
+	{
+		TypeName t = compiler.genericType(SUBSCRIPT.first, SUBSCRIPT.second, INFO);
+
+		for (auto e : SUBSCRIPT.second)
+			delete e;
+
+		return t;
+	}
+
+	// Object of an id whose first COUNT parts are a variable and its fields
+	// For example :
+	// p.pos.x : field x of the field pos of p
+	static Expression *objectUsage(const Id &ID, const size_t COUNT, const ErrorInfo &INFO)
+	{
+		Expression *e = new VariableUsage(INFO, Id(ID.ids[0]));
+
+		for (size_t i = 1; i < COUNT; ++i)
+			e = new FieldUsage(INFO, e, ID.ids[i]);
+
+		return e;
+	}
+
+	// Field of an element of a collection (ps[i].x)
+	// * The other indices are deleted
+	static FieldUsage *elementUsage(const pair<Id, vector<Expression*>> &SUBSCRIPT, const Id &FIELDS,
+		const ErrorInfo &INFO)
+	{
+		auto e = new FieldUsage(INFO, objectUsage(SUBSCRIPT.first, SUBSCRIPT.first.ids.size(), INFO),
+			FIELDS.ids[0], SUBSCRIPT.second[0]);
+
+		for (size_t i = 1; i < SUBSCRIPT.second.size(); ++i)
+			delete SUBSCRIPT.second[i];
+
+		for (size_t i = 1; i < FIELDS.ids.size(); ++i)
+			e = new FieldUsage(INFO, e, FIELDS.ids[i]);
+
+		return e;
+	}
+
+	// Id of a type which is not a table
+	#define TYPE_ID(TYPE, LOC) compiler.plainType(TYPE, LOC_ERROR(LOC))
+
 	// Shortcut for errors
 	// !!! TODO : DEPRECATED
 	#define ERROR_INFO scanner.errorInfo()
@@ -100,20 +145,40 @@
 	MOD						"%"
 	PAR_BEGIN				"("
 	PAR_END					")"
+	BRACKET_BEGIN			"["
+	BRACKET_END				"]"
 	PERIOD					"."
 	COMMA					","
 	ELLIPSIS				"..."
+	COLON					":"
 	AUTO					"$"
 	IF						"?"
 	OR						"or keyword"
 	WHILE					"while keyword"
 	FOR						"for keyword"
 	TO						"to keyword"
+	STEP					"step keyword"
 	USE						"use keyword"
 	CDEF					"cdef keyword"
 	OBJ						"obj keyword"
 	RET						"ret keyword"
+	PURE					"pure keyword"
+	CONST					"const keyword"
+	MEMO					"memo keyword"
+	SOA						"soa keyword"
+	ALIGN					"align keyword"
+	PACKED					"packed keyword"
+	CACHELINE				"cacheline keyword"
+	NOALIAS					"noalias keyword"
+	SIMD					"simd keyword"
+	IVDEP					"ivdep keyword"
+	UNROLL					"unroll keyword"
+	PAR						"par keyword"
+	REDUCE					"reduce keyword"
+	SPAWN					"spawn keyword"
+	SYNC					"sync keyword"
 	<int> INDENT_UPDT		"Indentation update"
+	<int> LAZY				"Lazy function body"
 	<string> ID				"Identifier"
 	<string> INT			"Integer (int)"
 	<string> NUM			"Float number (num)"
@@ -129,6 +194,9 @@
 %type <OrStatement*>			or_stmt;
 %type <Expression*>				expr;
 %type <Function*>				function;
+%type <Constant*>				constant;
+%type <FunctionModifiers>		modifiers;
+%type <int>						memo;
 %type <Literal*>				literal;
 %type <UnaryOperation*>			unary_op;
 %type <Module>					import;
@@ -136,8 +204,23 @@
 %type <Call*>					call_start;
 %type <Block*>					block;
 %type <Block*>					block_start;
+%type <int>						lazy_block;
 %type <TypeDecl>				type_decl;
+%type <TypeDecl>				fields;
+%type <TypeDecl>				obj_start;
+%type <Field>					field;
+%type <LayoutAttributes>		layout;
+%type <int>						align;
+%type <IMonoBlockStatement*>	loop;
+%type <LoopHints>				hints;
+%type <int>						unroll;
+%type <std::vector<Reduction>>	reduce;
+%type <std::vector<Reduction>>	reduce_start;
+%type <string>					reduce_op;
 %type <Id>						id;
+%type <TypeName>				type;
+%type <std::pair<Id, std::vector<Expression*>>>	subscript;
+%type <std::vector<Expression*>>	exprs;
 %type <string>					assign_op;
 %type <char>					new_line;
 %type <std::vector<Argument*>>	args;
@@ -163,17 +246,85 @@ program:
 	| program START					{}
 	| program stmt					{ compiler.pushGlobalStatement($2); }
 	| program function				{ compiler.addFunction($2); }
+	| program constant				{ compiler.addConstant($2); }
 	| program import				{ compiler.import($2, LOC_ERROR(@2)); }
 	| program type_decl				{ compiler.newType($2); }
 	;
 
 type_decl:
-	OBJ id new_line					{ $$ = TypeDecl(LOC_ERROR(@2), $2); }
+	obj_start new_line				{ $$ = $1; }
+	| obj_start SOA type new_line	{ $$ = $1; $$.soaOf = TYPE_ID($3, @3);
+									  if ($$.attributes.packed) error(@1, "A collection can't be packed"); }
+	| fields DEDENT					{ $$ = $1; }
+	;
+
+obj_start:
+	OBJ id							{ $$ = TypeDecl(LOC_ERROR(@2), $2); }
+	| layout OBJ id					{ $$ = TypeDecl(LOC_ERROR(@3), $3); $$.attributes = $1; }
+	;
+
+// Type with its fields
+fields:
+	obj_start new_line INDENT field	{ $$ = $1; $$.fields.push_back($4); }
+	| fields field					{ $$ = $1; $$.fields.push_back($2); }
+	;
+
+field:
+	type id new_line				{ $$ = Field(); $$.type = TYPE_ID($1, @1); $$.id = $2; }
+	| layout type id new_line		{ $$ = Field(); $$.type = TYPE_ID($2, @2); $$.id = $3; $$.attributes = $1;
+									  if ($1.packed) error(@1, "A field can't be packed"); }
+	;
+
+// Layout attributes (see LayoutAttributes)
+layout:
+	align							{ $$ = LayoutAttributes(); $$.align = $1; }
+	| PACKED						{ $$ = LayoutAttributes(); $$.packed = true; }
+	| CACHELINE						{ $$ = LayoutAttributes(); $$.cacheline = true; }
+	| layout align					{ $$ = $1; $$.align = max($$.align, $2); }
+	| layout PACKED					{ $$ = $1; $$.packed = true; }
+	| layout CACHELINE				{ $$ = $1; $$.cacheline = true; }
+	;
+
+align:
+	ALIGN PAR_BEGIN INT PAR_END		{ $$ = stoi($3); if ($$ <= 0 || ($$ & ($$ - 1))) error(@3, "The alignment must be a power of two"); }
 	;
 
 function:
-	id id args new_line block		{ $$ = new UpFunction(LOC_ERROR(@2), $1, $2, $3, $5); }
-	| CDEF id id args new_line 		{ $$ = Function::createCDef(LOC_ERROR(@3), $2, $3, $4); }
+	type id args new_line block		{ $$ = new UpFunction(LOC_ERROR(@2), TYPE_ID($1, @1), $2, $3, $5); }
+	| type id args new_line lazy_block
+									{ $$ = compiler.lazyFunction(LOC_ERROR(@2), TYPE_ID($1, @1), $2, $3, $5); }
+	| modifiers type id args new_line block
+									{ $$ = new UpFunction(LOC_ERROR(@3), TYPE_ID($2, @2), $3, $4, $6); $$->modifiers = $1; }
+	| modifiers type id args new_line lazy_block
+									{ $$ = compiler.lazyFunction(LOC_ERROR(@3), TYPE_ID($2, @2), $3, $4, $6); $$->modifiers = $1; }
+	| CDEF type id args new_line 	{ $$ = Function::createCDef(LOC_ERROR(@3), TYPE_ID($2, @2), $3, $4); }
+	| CDEF modifiers type id args new_line
+									{ $$ = Function::createCDef(LOC_ERROR(@4), TYPE_ID($3, @3), $4, $5); $$->modifiers = $2; }
+	;
+
+// * The modifiers are parsed like those of functions (no conflict)
+constant:
+	modifiers type id EQ expr new_line
+									{ $$ = new Constant(LOC_ERROR(@3), TYPE_ID($2, @2), $3, $5);
+									  if ($1.memo || $1.purity != Purity::Const) error(@1, "A constant must be declared with the const keyword only"); }
+	| modifiers type id FOR id EQ expr new_line
+									{ $$ = new Constant(LOC_ERROR(@3), $2.id, $3, $7, $2.count, $5);
+									  if ($2.count == 0) error(@2, "The table must have a size (int[size])");
+									  if ($1.memo || $1.purity != Purity::Const) error(@1, "A constant must be declared with the const keyword only"); }
+	;
+
+modifiers:
+	PURE							{ $$ = FunctionModifiers(); $$.purity = Purity::Pure; }
+	| CONST							{ $$ = FunctionModifiers(); $$.purity = Purity::Const; }
+	| modifiers PURE				{ $$ = $1; $$.purity = max($$.purity, Purity::Pure); }
+	| modifiers CONST				{ $$ = $1; $$.purity = Purity::Const; }
+	| memo							{ $$ = FunctionModifiers(); $$.memo = true; if ($1) $$.memoCapacity = $1; }
+	| modifiers memo				{ $$ = $1; $$.memo = true; if ($2) $$.memoCapacity = $2; }
+	;
+
+memo:
+	MEMO							{ $$ = 0; /* Default capacity */ }
+	| MEMO PAR_BEGIN INT PAR_END	{ $$ = stoi($3); if ($$ == 0) $$ = -1; }
 	;
 
 block:
@@ -181,6 +332,11 @@ block:
 	| block new_line				{ $$ = $1; /* New line after unindentation is ignored */ }
 	;
 
+lazy_block:
+	INDENT LAZY new_line DEDENT		{ $$ = $2; }
+	| lazy_block new_line			{ $$ = $1; }
+	;
+
 block_start:
 	INDENT stmt						{ $$ = new Block(LOC_ERROR(@2)); $$->pushStatement($2); }
 	| block_start stmt				{ $$ = $1; $$->pushStatement($2); }
@@ -193,26 +349,89 @@ args:
 	;
 
 args_start:
-	PAR_BEGIN id id					{ $$ = { new Argument(ERROR_INFO, $2, $3) }; }
-	| args_start COMMA id id		{ $$ = $1; $$.push_back(new Argument(ERROR_INFO, $3, $4)); }
+	PAR_BEGIN type id				{ $$ = { new Argument(ERROR_INFO, TYPE_ID($2, @2), $3) }; }
+	| PAR_BEGIN NOALIAS type id		{ $$ = { new Argument(ERROR_INFO, TYPE_ID($3, @3), $4, true) }; }
+	| args_start COMMA type id		{ $$ = $1; $$.push_back(new Argument(ERROR_INFO, TYPE_ID($3, @3), $4)); }
+	| args_start COMMA NOALIAS type id
+									{ $$ = $1; $$.push_back(new Argument(ERROR_INFO, TYPE_ID($4, @4), $5, true)); }
 	;
 
 stmt:
-	id id EQ expr new_line 			{ $$ = new VariableDeclaration(ERROR_INFO, $2, $1, $4); }
+	type id EQ expr new_line 		{ $$ = new VariableDeclaration(ERROR_INFO, $2, TYPE_ID($1, @1), $4); }
 	| AUTO id EQ expr new_line 		{ $$ = new VariableDeclaration(ERROR_INFO, $2, Id::createAuto(), $4); }
-	| AUTO id id new_line			{ $$ = new VariableDeclaration(ERROR_INFO, $3, $2, nullptr); }
-	| id assign_op expr new_line 	{ $$ = new VariableAssignement(ERROR_INFO, $1, $3, $2); }
+	| AUTO type id new_line			{ $$ = new VariableDeclaration(ERROR_INFO, $3, $2.id, nullptr, $2.count); }
+	| type id new_line				{ $$ = new VariableDeclaration(ERROR_INFO, $2, $1.id, nullptr, $1.count);
+									  if ($1.count == 0) error(@1, "A variable without value is declared with $ ($int a)"); }
+	| id assign_op expr new_line 	{ if ($1.isSimple()) $$ = new VariableAssignement(ERROR_INFO, $1, $3, $2);
+									  else $$ = new FieldAssignement(ERROR_INFO, (FieldUsage*) objectUsage($1, $1.ids.size(), LOC_ERROR(@1)), $3, $2); }
+	| subscript assign_op expr new_line
+									{ $$ = new IndexAssignement(ERROR_INFO, new Index(LOC_ERROR(@1), $1.first, $1.second[0]), $3, $2);
+									  for (size_t i = 1; i < $1.second.size(); ++i) delete $1.second[i];
+									  if ($1.second.size() != 1) error(@1, "A table has only one index"); }
+	| subscript PERIOD id assign_op expr new_line
+									{ $$ = new FieldAssignement(ERROR_INFO, elementUsage($1, $3, LOC_ERROR(@1)), $5, $4);
+									  if ($1.second.size() != 1) error(@1, "A collection has only one index"); }
 	| RET expr new_line 			{ $$ = new Return(ERROR_INFO, $2); }
 	| RET new_line	 				{ $$ = new Return(ERROR_INFO, nullptr); }
-	| WHILE expr new_line block		{ $$ = new ControlStatement(ERROR_INFO, $2, $4, "while"); }
-	| FOR id EQ expr TO
-		expr new_line block			{ $$ = new ForStatement(ERROR_INFO, $2, $4, $6, $8); }
-	| FOR id TO expr new_line block	{ $$ = ForStatement::createDefaultInit(ERROR_INFO, $2, $4, $6); }
+	| SPAWN call new_line			{ $$ = new Spawn(ERROR_INFO, $2); }
+	| AUTO id EQ SPAWN call new_line
+									{ $$ = new Spawn(ERROR_INFO, $5, $2, Id::createAuto()); }
+	| type id EQ SPAWN call new_line
+									{ $$ = new Spawn(ERROR_INFO, $5, $2, TYPE_ID($1, @1)); }
+	| SYNC new_line					{ $$ = new Sync(ERROR_INFO); }
+	| loop							{ $$ = $1; }
+	| hints loop					{ $$ = $2; $2->hints = $1; }
 	| expr new_line 				{ $$ = new ExpressionStatement(ERROR_INFO, $1); }
 	| conditions					{ $$ = $1; }
 	| CCODE new_line				{ $$ = new CStatement(ERROR_INFO, $1.substr(2, $1.size() - 4)); }
 	;
 
+loop:
+	WHILE expr new_line block		{ $$ = new ControlStatement(ERROR_INFO, $2, $4, "while"); }
+	| FOR id EQ expr TO
+		expr new_line block			{ $$ = new ForStatement(LOC_ERROR(@1), $2, $4, $6, $8); }
+	| FOR id TO expr new_line block	{ $$ = ForStatement::createDefaultInit(LOC_ERROR(@1), $2, $4, $6); }
+	| FOR id EQ expr TO expr
+		STEP expr new_line block	{ $$ = new ForStatement(LOC_ERROR(@1), $2, $4, $6, $10, $8); }
+	| FOR id TO expr STEP
+		expr new_line block			{ $$ = ForStatement::createDefaultInit(LOC_ERROR(@1), $2, $4, $8, $6); }
+	;
+
+// Loop annotations (see LoopHints)
+hints:
+	SIMD							{ $$ = LoopHints(); $$.simd = true; }
+	| IVDEP							{ $$ = LoopHints(); $$.ivdep = true; }
+	| unroll						{ $$ = LoopHints(); $$.unroll = $1; }
+	| PAR							{ $$ = LoopHints(); $$.par = true; }
+	| reduce						{ $$ = LoopHints(); $$.reductions = $1; }
+	| hints SIMD					{ $$ = $1; $$.simd = true; }
+	| hints IVDEP					{ $$ = $1; $$.ivdep = true; }
+	| hints unroll					{ $$ = $1; $$.unroll = $2; }
+	| hints PAR						{ $$ = $1; $$.par = true; }
+	| hints reduce					{ $$ = $1; $$.reductions.insert($$.reductions.end(), $2.begin(), $2.end()); }
+	;
+
+unroll:
+	UNROLL PAR_BEGIN INT PAR_END	{ $$ = stoi($3); if ($$ <= 0 || $$ > 65534) error(@3, "The unroll factor must be within 1 and 65534"); }
+	;
+
+// reduce(+: a, b)
+reduce:
+	reduce_start PAR_END			{ $$ = $1; }
+	;
+
+reduce_start:
+	REDUCE PAR_BEGIN reduce_op COLON id
+									{ $$ = { Reduction{ $3, $5 } }; }
+	| reduce_start COMMA id			{ $$ = $1; $$.push_back(Reduction{ $1[0].op, $3 }); }
+	;
+
+reduce_op:
+	ADD								{ $$ = "+"; }
+	| MUL							{ $$ = "*"; }
+	| ID							{ $$ = $1; if ($1 != "min" && $1 != "max") error(@1, "The operator of a reduction is +, *, min or max"); }
+	;
+
 conditions:
 	if_stmt							{ $$ = new ConditionSequence(LOC_ERROR(@1), $1); }
 	| conditions or_if_stmt			{ $$ = $1; $$->controls.push_back($2); }
@@ -246,7 +465,12 @@ expr:
 	| expr LESS expr				{ $$ = new BinaryOperation(LOC_ERROR(@2), $1, $3, "<", true); }
 	| expr AEQ expr					{ $$ = new BinaryOperation(LOC_ERROR(@2), $1, $3, ">=", true); }
 	| expr ABOV expr				{ $$ = new BinaryOperation(LOC_ERROR(@2), $1, $3, ">", true); }
-	| id							{ $$ = new VariableUsage(ERROR_INFO, $1); }
+	| id							{ $$ = $1.isSimple() ? new VariableUsage(ERROR_INFO, $1) : objectUsage($1, $1.ids.size(), LOC_ERROR(@1)); }
+	| subscript PERIOD id			{ $$ = elementUsage($1, $3, LOC_ERROR(@1));
+									  if ($1.second.size() != 1) error(@1, "A collection has only one index"); }
+	| subscript						{ $$ = new Index(LOC_ERROR(@1), $1.first, $1.second[0]);
+									  for (size_t i = 1; i < $1.second.size(); ++i) delete $1.second[i];
+									  if ($1.second.size() != 1) error(@1, "A table has only one index"); }
 	;
 
 import:
@@ -283,9 +507,27 @@ call:
 
 call_start:
 	id PAR_BEGIN					{ $$ = new Call(ErrorInfo(scanner.module, @1.begin.line, @1.begin.column), $1); }
+	| subscript PAR_BEGIN			{ $$ = new Call(LOC_ERROR(@1), compiler.plainType(genericType(compiler, $1, LOC_ERROR(@1)), LOC_ERROR(@1))); }
 	| call_start expr COMMA			{ $$ = $1; $$->args.push_back($2); }
 	;
 
+// Generic type or index of a table
+// * Array[int] : type, SINE[i] : expression
+subscript:
+	id BRACKET_BEGIN exprs BRACKET_END
+									{ $$ = { $1, $3 }; }
+	;
+
+exprs:
+	expr							{ $$ = { $1 }; }
+	| exprs COMMA expr				{ $$ = $1; $$.push_back($3); }
+	;
+
+type:
+	id								{ $$ = TypeName(); $$.id = $1; }
+	| subscript						{ $$ = genericType(compiler, $1, LOC_ERROR(@1)); }
+	;
+
 id:
 	ID								{ $$ = Id($1); }
 	| id PERIOD ID					{ $$ = $1; $$.ids.push_back($3); }
@@ -1,7 +1,6 @@
 #include "scanner.h"
 
 #include "compiler.h"
-#include "global.h"
 
 using namespace std;
 
@@ -89,36 +88,48 @@ namespace up
     }
 
     bool Scanner::beginParse(const Module &MOD)
+    {
+        string content;
+
+        // Relative or include module
+        if (!compiler.fs.read(compiler.resolvePath(MOD), content))
+            // Can't open module
+            return false;
+
+        beginParse(MOD, compiler.prepareSource(MOD, content));
+        
+        return true;
+    }
+
+    void Scanner::beginParse(const Module &MOD, const string &TEXT, const int LINE)
     {
         loc = Parser::location_type();
+        loc.lines(LINE - 1);
+        loc.step();
         indent = 0;
         module = MOD;
         tokens = std::deque<Parser::symbol_type>();
         tokens.push_back(Parser::make_START(loc));
         ended = false;
 
-        // Try open relative module
-        fileInput.open(MOD.path());
-        if (fileInput.is_open())
-            goto fileOpen;
-
-        // Try open include module
-        fileInput.open(includeDir + MOD.id.toPath());
-        if (fileInput.is_open())
-            goto fileOpen;
-
-        // Can't open module
-        return false;
-
-    fileOpen:;
-        switch_streams(fileInput, cout);
-        
-        return true;
+#ifdef UP_HAND_LEXER
+        source = TEXT;
+        cursor = 0;
+        atBol = true;
+#else
+        input.clear();
+        input.str(TEXT);
+        switch_streams(input, cout);
+#endif
     }
 
     void Scanner::endParse()
     {
-        fileInput.close();
+#ifdef UP_HAND_LEXER
+        source.clear();
+#else
+        input.str("");
+#endif
     }
 
     void Scanner::updateIndent(const int NEW_INDENT)
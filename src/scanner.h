@@ -1,7 +1,7 @@
 #pragma once
 
 #include <string>
-#include <fstream>
+#include <sstream>
 #include <deque>
 
 #include "components.h"
@@ -9,21 +9,28 @@
 #include "error_info.h"
 #include "parser.hpp"
 
-#if ! defined(yyFlexLexerOnce)
-# undef yyFlexLexer
-# define yyFlexLexer UpFlexLexer
-# include <FlexLexer.h>
-#endif
+// UP_HAND_LEXER : next is implemented in hand_lexer.cpp
+// instead of the flex lexer (lexer.l)
+#ifndef UP_HAND_LEXER
+# if ! defined(yyFlexLexerOnce)
+#  undef yyFlexLexer
+#  define yyFlexLexer UpFlexLexer
+#  include <FlexLexer.h>
+# endif
 
 // Set the lex function
-#undef YY_DECL
-#define YY_DECL up::Parser::symbol_type up::Scanner::next()
+# undef YY_DECL
+# define YY_DECL up::Parser::symbol_type up::Scanner::next()
+#endif
 
 namespace up
 {
     class Compiler;
 
-    class Scanner : public UpFlexLexer
+    class Scanner
+#ifndef UP_HAND_LEXER
+        : public UpFlexLexer
+#endif
     {
         friend class Parser;
 
@@ -44,6 +51,8 @@ namespace up
         // Reset attributes to parse a new file
         // Returns whether there is no error
         bool beginParse(const Module &MOD);
+        // Parses TEXT which begins at the line LINE of the module
+        void beginParse(const Module &MOD, const std::string &TEXT, const int LINE=1);
         void endParse();
 
         // Moves the cursor
@@ -64,12 +73,31 @@ namespace up
         // !!! TEXT must have either tabs or spaces
         int countTabs(const char *TEXT, const int LEN) const;
 
+#ifdef UP_HAND_LEXER
+        // Moves the cursor and the location after LEN characters
+        void consume(const size_t LEN);
+
+        // Scans the number (int or num) or the word (id or keyword) at p
+        Parser::symbol_type number(const char *p, const char *end);
+        Parser::symbol_type word(const char *p, const char *end);
+#endif
+
     private:
         Compiler &compiler;
 
         // Current file to parse as module
         Module module;
-        std::ifstream fileInput;
+#ifdef UP_HAND_LEXER
+        // The content of the module (read with the compiler's file system)
+        std::string source;
+        // Position of the next token within source
+        size_t cursor;
+        // Whether the cursor is at the beginning of a line
+        bool atBol;
+#else
+        // The content of the module (read with the compiler's file system)
+        std::istringstream input;
+#endif
 
         // Current indentation
         int indent;
@@ -0,0 +1,360 @@
+#include "server.h"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/inotify.h>
+
+#include "compiler.h"
+#include "colors.h"
+
+using namespace std;
+
+namespace up
+{
+    namespace
+    {
+        // Events of a watched folder which change a source
+        const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+        // Maximum size of a request line
+        const size_t MAX_REQUEST = 1 << 16;
+
+        // Returns the folder of the file located at PATH
+        string folderOf(const string &PATH)
+        {
+            size_t slash = PATH.find_last_of('/');
+
+            if (slash == string::npos)
+                return ".";
+
+            return slash == 0 ? "/" : PATH.substr(0, slash);
+        }
+
+        bool endsWith(const string &S, const string &END)
+        {
+            return S.size() >= END.size() && S.compare(S.size() - END.size(), END.size(), END) == 0;
+        }
+
+        // Writes all DATA to the file descriptor
+        bool writeAll(int fd, const string &DATA)
+        {
+            for (size_t written = 0; written < DATA.size(); )
+            {
+                ssize_t n = write(fd, DATA.data() + written, DATA.size() - written);
+
+                if (n <= 0)
+                    return false;
+
+                written += n;
+            }
+
+            return true;
+        }
+
+        // Reads until the end of the connection
+        string readAll(int fd)
+        {
+            string data;
+            char buf[4096];
+            ssize_t n;
+
+            while ((n = read(fd, buf, sizeof(buf))) > 0)
+                data.append(buf, n);
+
+            return data;
+        }
+
+        // Creates the address of the socket
+        // Returns false if the path is too long
+        bool socketAddress(const string &PATH, sockaddr_un &addr)
+        {
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+
+            if (PATH.size() >= sizeof(addr.sun_path))
+                return false;
+
+            strcpy(addr.sun_path, PATH.c_str());
+
+            return true;
+        }
+
+        class Server
+        {
+        public:
+            Server(Compiler &compiler)
+                : compiler(compiler)
+            {}
+
+            ~Server()
+            {
+                if (notifyFd >= 0)
+                    close(notifyFd);
+
+                if (socketFd >= 0)
+                {
+                    close(socketFd);
+                    unlink(socketPath.c_str());
+                }
+            }
+
+        public:
+            // Creates the socket and the inotify instance
+            // Returns whether there is no error
+            bool open(const string &SOCKET_PATH)
+            {
+                socketPath = SOCKET_PATH;
+
+                notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (notifyFd < 0)
+                {
+                    cerr << "Can't watch source files (inotify)\n";
+                    return false;
+                }
+
+                sockaddr_un addr;
+                if (!socketAddress(SOCKET_PATH, addr))
+                {
+                    cerr << "The socket path '" << SOCKET_PATH << "' is too long\n";
+                    return false;
+                }
+
+                // Remove the socket of a previous server
+                unlink(SOCKET_PATH.c_str());
+
+                socketFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (socketFd < 0 ||
+                    bind(socketFd, (sockaddr*) &addr, sizeof(addr)) != 0 ||
+                    listen(socketFd, 16) != 0)
+                {
+                    cerr << "Can't listen on '" << SOCKET_PATH << "' : " << strerror(errno) << '\n';
+                    return false;
+                }
+
+                return true;
+            }
+
+            // Waits for requests and changes until a stop request
+            int run()
+            {
+                pollfd fds[2] = {
+                    { socketFd, POLLIN, 0 },
+                    { notifyFd, POLLIN, 0 },
+                };
+
+                bool running = true;
+                while (running)
+                {
+                    if (poll(fds, 2, -1) < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+
+                        cerr << "Server error : " << strerror(errno) << '\n';
+                        return -1;
+                    }
+
+                    if (fds[1].revents & POLLIN)
+                        readEvents();
+
+                    if (fds[0].revents & POLLIN)
+                    {
+                        int client = accept(socketFd, nullptr, nullptr);
+
+                        if (client >= 0)
+                        {
+                            running = handle(client);
+                            close(client);
+                        }
+                    }
+                }
+
+                return 0;
+            }
+
+        private:
+            // Answers the request of the client
+            // Returns false if the server must stop
+            bool handle(int client)
+            {
+                string request;
+                char c;
+
+                // Read the request line
+                while (request.size() < MAX_REQUEST && read(client, &c, 1) == 1 && c != '\n')
+                    request += c;
+
+                bool ok = true;
+                string body;
+                bool running = true;
+
+                if (request.compare(0, 8, "compile ") == 0)
+                    body = compile(request.substr(8), false, ok);
+                else if (request.compare(0, 6, "check ") == 0)
+                    body = compile(request.substr(6), true, ok);
+                else if (request == "stop")
+                    running = false;
+                else
+                {
+                    ok = false;
+                    body = "Unknown request '" + request + "'\n";
+                }
+
+                writeAll(client, (ok ? "ok " : "error ") + to_string(body.size()) + "\n" + body);
+
+                return running;
+            }
+
+            // Compiles ENTRY, returns the C code or the diagnostics
+            // * Nothing is returned if CHECK and there is no error
+            string compile(const string &ENTRY, const bool CHECK, bool &ok)
+            {
+                // Apply changes which have not been polled yet
+                readEvents();
+
+                compiler.checkOnly = CHECK;
+
+                auto begin = chrono::steady_clock::now();
+                ok = compiler.compile(ENTRY) == 0;
+                auto end = chrono::steady_clock::now();
+
+                cerr << (CHECK ? "Checked " : "Compiled ") << ENTRY << " in " <<
+                    chrono::duration<double, milli>(end - begin).count() << " ms\n";
+
+                // The entry and its imports are watched
+                // * The entry is not cached, it is always parsed
+                watch(folderOf(ENTRY));
+                for (auto &path : compiler.cachedModules())
+                    watch(folderOf(path));
+
+                if (ok)
+                    return compiler.output();
+
+                string diagnostics;
+                for (auto &d : compiler.diagnostics)
+                    diagnostics += "File " + removeColors(d.info.toString()) +
+                        " - " + d.reason + " Error :\n" + d.message + '\n';
+
+                return diagnostics;
+            }
+
+            // Watches the folder if it is not already watched
+            void watch(const string &FOLDER)
+            {
+                if (watchedFolders.find(FOLDER) != watchedFolders.end())
+                    return;
+
+                int wd = inotify_add_watch(notifyFd, FOLDER.c_str(), WATCH_MASK);
+                if (wd < 0)
+                    return;
+
+                watchedFolders.insert(FOLDER);
+                folders[wd] = FOLDER;
+            }
+
+            // Invalidates modules whose source has changed
+            void readEvents()
+            {
+                alignas(inotify_event) char buf[4096];
+                ssize_t n;
+
+                while ((n = read(notifyFd, buf, sizeof(buf))) > 0)
+                    for (char *p = buf; p < buf + n; )
+                    {
+                        auto event = (const inotify_event*) p;
+                        p += sizeof(inotify_event) + event->len;
+
+                        auto folder = folders.find(event->wd);
+                        if (folder == folders.end())
+                            continue;
+
+                        // The folder has been removed
+                        if (event->mask & IN_IGNORED)
+                        {
+                            watchedFolders.erase(folder->second);
+                            folders.erase(folder);
+                            continue;
+                        }
+
+                        if (event->len == 0)
+                            continue;
+
+                        string path = VirtualFS::normalize(folder->second + "/" + event->name);
+
+                        // A precompiled module replaces its source
+                        if (endsWith(path, ".upm"))
+                            path.pop_back();
+                        else if (!endsWith(path, ".up"))
+                            continue;
+
+                        compiler.invalidateModule(path);
+                    }
+            }
+
+        private:
+            Compiler &compiler;
+            string socketPath;
+            int socketFd = -1;
+            int notifyFd = -1;
+            // Watch descriptor -> folder
+            map<int, string> folders;
+            set<string> watchedFolders;
+        };
+    } // namespace
+
+    int serve(Compiler &compiler, const string &SOCKET_PATH)
+    {
+        compiler.cacheModules = true;
+        compiler.errorStream = nullptr;
+
+        // Clients may close the connection before the response
+        signal(SIGPIPE, SIG_IGN);
+
+        Server server(compiler);
+
+        if (!server.open(SOCKET_PATH))
+            return -1;
+
+        cerr << "Listening on " << SOCKET_PATH << '\n';
+
+        return server.run();
+    }
+
+    int sendRequest(const string &SOCKET_PATH, const string &REQUEST, string &response)
+    {
+        sockaddr_un addr;
+        if (!socketAddress(SOCKET_PATH, addr))
+            return -1;
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+
+        if (connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || !writeAll(fd, REQUEST + "\n"))
+        {
+            close(fd);
+            return -1;
+        }
+
+        const string DATA = readAll(fd);
+        close(fd);
+
+        // Header : ok|error <size>
+        size_t newLine = DATA.find('\n');
+        if (newLine == string::npos)
+            return -1;
+
+        response = DATA.substr(newLine + 1);
+
+        return DATA.compare(0, 3, "ok ") == 0 ? 0 : 1;
+    }
+} // namespace up
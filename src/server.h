@@ -0,0 +1,25 @@
+#pragma once
+
+// Resident compiler : imported modules stay in memory between
+// requests and are parsed again only when their source changes
+// Requests are received through a Unix socket (one per connection) :
+// compile <entry.up>\n -> ok <size>\n<C code> or error <size>\n<diagnostics>
+// check <entry.up>\n -> ok 0\n or error <size>\n<diagnostics>
+// stop\n -> ok 0\n (the server exits)
+
+#include <string>
+
+namespace up
+{
+    class Compiler;
+
+    // Serves requests on the socket located at SOCKET_PATH
+    // * Source files are watched with inotify
+    // Returns 0 if the server has been stopped without error
+    int serve(Compiler &compiler, const std::string &SOCKET_PATH);
+
+    // Sends a request to the server listening on SOCKET_PATH
+    // response is the body of the response (C code or diagnostics)
+    // Returns 0 if the server responds ok
+    int sendRequest(const std::string &SOCKET_PATH, const std::string &REQUEST, std::string &response);
+} // namespace up
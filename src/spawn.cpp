@@ -0,0 +1,133 @@
+#include "spawn.h"
+
+using namespace std;
+
+namespace up
+{
+    const string SPAWN_RUNTIME = R"(#ifndef _UP_SPAWN
+#define _UP_SPAWN
+// Work-stealing scheduler of the spawned calls
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Power of two, a task is run by the spawning thread if its deque is full
+#define _UP_DEQUE_SIZE 8192
+
+typedef struct { atomic_int pending; } _UpFrame;
+typedef struct _UpTask { void (*run)(struct _UpTask*); _UpFrame *frame; } _UpTask;
+typedef struct {
+	_Alignas(64) atomic_long top;
+	_Alignas(64) atomic_long bottom;
+	_Atomic(_UpTask*) tasks[_UP_DEQUE_SIZE];
+} _UpDeque;
+
+static _UpDeque *_upDeques;
+static int _upWorkers = 1;
+// -1 if this thread is not a worker (its tasks are run when they are spawned)
+static __thread int _upWorker = -1;
+static __thread unsigned _upSeed;
+
+static int _upPush(_UpDeque *d, _UpTask *task) {
+	long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+	long t = atomic_load_explicit(&d->top, memory_order_acquire);
+	if (b - t >= _UP_DEQUE_SIZE) return 0;
+	atomic_store_explicit(&d->tasks[b & (_UP_DEQUE_SIZE - 1)], task, memory_order_relaxed);
+	atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+	return 1;
+}
+
+static _UpTask *_upPop(_UpDeque *d) {
+	long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+	// Seen by the thieves before top is read
+	atomic_store_explicit(&d->bottom, b, memory_order_seq_cst);
+	long t = atomic_load_explicit(&d->top, memory_order_seq_cst);
+	_UpTask *task = NULL;
+	if (t <= b) {
+		task = atomic_load_explicit(&d->tasks[b & (_UP_DEQUE_SIZE - 1)], memory_order_relaxed);
+		// Last task, a thief may take it
+		if (t == b) {
+			if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+				task = NULL;
+			atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+		}
+	} else
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+	return task;
+}
+
+static _UpTask *_upSteal(_UpDeque *d) {
+	long t = atomic_load_explicit(&d->top, memory_order_seq_cst);
+	long b = atomic_load_explicit(&d->bottom, memory_order_seq_cst);
+	if (t >= b) return NULL;
+	_UpTask *task = atomic_load_explicit(&d->tasks[t & (_UP_DEQUE_SIZE - 1)], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return task;
+}
+
+static void _upRun(_UpTask *task) {
+	_UpFrame *frame = task->frame;
+	task->run(task);
+	atomic_fetch_sub_explicit(&frame->pending, 1, memory_order_release);
+}
+
+// Runs a task of this worker or a task stolen from a random worker
+// Returns 0 if there is no task
+static int _upWork(void) {
+	_UpTask *task = _upPop(&_upDeques[_upWorker]);
+	if (!task) {
+		_upSeed = _upSeed * 1103515245u + 12345u;
+		int victim = (_upSeed >> 16) % _upWorkers;
+		if (victim != _upWorker) task = _upSteal(&_upDeques[victim]);
+	}
+	if (!task) return 0;
+	_upRun(task);
+	return 1;
+}
+
+static void *_upWorkerLoop(void *worker) {
+	_upWorker = (int) (long) worker;
+	_upSeed = _upWorker + 1;
+	// Sleeps when there is no task for a while
+	for (int idle = 0; ; )
+		if (_upWork()) idle = 0;
+		else if (++idle < 1024) sched_yield();
+		else { struct timespec t = { 0, 100000 }; nanosleep(&t, NULL); }
+	return NULL;
+}
+
+__attribute__((constructor)) static void _upStartWorkers(void) {
+	const char *count = getenv("UP_WORKERS");
+	_upWorkers = count ? atoi(count) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (_upWorkers < 1) _upWorkers = 1;
+	_upDeques = aligned_alloc(64, sizeof(_UpDeque) * _upWorkers);
+	for (int i = 0; i < _upWorkers; ++i) {
+		atomic_init(&_upDeques[i].top, 0);
+		atomic_init(&_upDeques[i].bottom, 0);
+	}
+	_upWorker = 0;
+	_upSeed = 1;
+	for (long i = 1; i < _upWorkers; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, _upWorkerLoop, (void*) i) == 0)
+			pthread_detach(thread);
+	}
+}
+
+static void _upSpawn(_UpFrame *frame, _UpTask *task) {
+	task->frame = frame;
+	atomic_fetch_add_explicit(&frame->pending, 1, memory_order_relaxed);
+	if (_upWorker < 0 || !_upPush(&_upDeques[_upWorker], task)) _upRun(task);
+}
+
+static void _upSync(_UpFrame *frame) {
+	while (atomic_load_explicit(&frame->pending, memory_order_acquire) > 0)
+		if (_upWorker < 0 || !_upWork()) sched_yield();
+}
+#endif
+)";
+} // namespace up
@@ -0,0 +1,18 @@
+#pragma once
+
+// Runtime of the spawned calls (see Spawn)
+
+#include <string>
+
+namespace up
+{
+    // C code of the work-stealing scheduler, emitted before each function
+    // which spawns calls (guarded by _UP_SPAWN)
+    // * Each worker thread has a Chase-Lev deque of tasks, it pushes and
+    //   pops its tasks at the bottom, the other workers steal at the top
+    // * The main thread is the worker 0, the other workers are started
+    //   before main (one per processor or UP_WORKERS)
+    // * A frame counts the pending tasks spawned by a function call,
+    //   _upSync runs or steals tasks until they are done
+    extern const std::string SPAWN_RUNTIME;
+} // namespace up
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <set>
+#include <algorithm>
 
 #include "compiler.h"
 #include "components.h"
@@ -18,7 +19,7 @@ namespace up
     // TODO : Change init when mangling
     // TODO : Not operator
     // TODO : _new _del etc...
-    set<string> typeOperators = {
+    const set<string> BUILTIN_OPERATORS = {
         "int+",
         "int-",
         "int*",
@@ -54,7 +55,7 @@ namespace up
         "bool!=",
     };
 
-    set<Id> types = {
+    const set<Id> BUILTIN_TYPES = {
         Id::createEllipsis(),
      
         Id("int"),
@@ -66,6 +67,10 @@ namespace up
         Id("str"),
     };
 
+    set<string> typeOperators = BUILTIN_OPERATORS;
+    set<Id> types = BUILTIN_TYPES;
+    vector<TypeDecl> typeLayouts;
+
     TypeDecl::TypeDecl(const ErrorInfo &INFO, const Id &ID)
         : info(INFO), id(ID)
     {}
@@ -88,6 +93,55 @@ namespace up
         }
 
         types.insert(id);
+
+        if (hasLayout())
+            typeLayouts.push_back(*this);
+    }
+
+    const Field *TypeDecl::getField(const string &ID) const
+    {
+        for (auto &f : fields)
+            if (f.id == ID)
+                return &f;
+
+        return nullptr;
+    }
+
+    int TypeDecl::declaredAlign() const
+    {
+        return max(attributes.align, attributes.cacheline ? CACHE_LINE : 0);
+    }
+
+    vector<FieldOffset> TypeDecl::offsets(int &size, int &align) const
+    {
+        vector<FieldOffset> result;
+        int offset = 0;
+        align = max(1, declaredAlign());
+
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            const Field &F = fields[i];
+            FieldOffset o;
+
+            // The field after a cacheline field begins a new cache line
+            o.declaredAlign = max(F.attributes.align,
+                F.attributes.cacheline || (i > 0 && fields[i - 1].attributes.cacheline) ? CACHE_LINE : 0);
+            o.size = typeSize(F.type);
+
+            // The aligned attribute can only increase the alignment
+            const int FIELD_ALIGN = max(attributes.packed ? 1 : o.size, o.declaredAlign);
+
+            o.offset = (offset + FIELD_ALIGN - 1) / FIELD_ALIGN * FIELD_ALIGN;
+            o.padding = o.offset - offset;
+            offset = o.offset + o.size;
+            align = max(align, FIELD_ALIGN);
+
+            result.push_back(o);
+        }
+
+        size = (offset + align - 1) / align * align;
+
+        return result;
     }
 
     string cType(const string &id)
@@ -112,6 +166,22 @@ namespace up
         return id;
     }
 
+    bool isTableType(const Id &TYPE)
+    {
+        return TYPE == "int" || TYPE == "num" || TYPE == "bool";
+    }
+
+    int typeSize(const Id &TYPE)
+    {
+        if (TYPE == "int" || TYPE == "num")
+            return 4;
+
+        if (TYPE == "bool")
+            return 1;
+
+        return 8;
+    }
+
     std::vector<string> typeArgList(const std::vector<Expression*> &ARGS)
     {
         vector<string> args;
@@ -136,11 +206,32 @@ namespace up
         types.insert(ID);
     }
 
+    void resetTypes()
+    {
+        types = BUILTIN_TYPES;
+        typeOperators = BUILTIN_OPERATORS;
+        typeLayouts.clear();
+    }
+
     bool typeExists(const Id &ID)
     {
         return types.find(ID) != types.end();
     }
 
+    const TypeDecl *layoutOf(const Id &TYPE)
+    {
+        for (auto &t : typeLayouts)
+            if (t.id == TYPE)
+                return &t;
+
+        return nullptr;
+    }
+
+    const vector<TypeDecl> &layouts()
+    {
+        return typeLayouts;
+    }
+
     bool compatibleType(const Id &a, const Id &b)
     {
         // TODO : Implicit casts (require cast...)
@@ -165,6 +256,20 @@ namespace up
         return typeOperators.find(MANGLED) != typeOperators.end();
     }
 
+    vector<string> operatorsOf(const Id &TYPE)
+    {
+        const string PREFIX = TYPE.toUp();
+        vector<string> ops;
+
+        for (auto mangled : typeOperators)
+            // The operator follows the type (an operator is not alphanumeric)
+            if (mangled.size() > PREFIX.size() && mangled.compare(0, PREFIX.size(), PREFIX) == 0 &&
+                !isalnum(mangled[PREFIX.size()]))
+                ops.push_back(mangled.substr(PREFIX.size()));
+
+        return ops;
+    }
+
     bool isBuiltin(const Id &TYPE)
     {
         return TYPE == "int" || TYPE == "num" || TYPE == "bool" || TYPE == "nil";
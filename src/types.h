@@ -13,9 +13,60 @@ namespace up
     class Expression;
     class Compiler;
 
+    // Size of a cache line in bytes
+    const int CACHE_LINE = 64;
+
+    // Maximum size in bytes of a table variable (on the stack)
+    const int MAX_TABLE_SIZE = 1 << 20;
+
+    // Written before an object or a field
+    // For example :
+    // packed obj Header
+    // align(16) num x
+    // cacheline int hits
+    struct LayoutAttributes
+    {
+        // Minimum alignment in bytes (0 if not declared)
+        int align = 0;
+        // No padding between the fields (object only)
+        bool packed = false;
+        // Alone within its cache lines (aligned to a cache line,
+        // the next field begins a new cache line)
+        bool cacheline = false;
+
+        // Whether an attribute is declared
+        inline bool any() const
+        { return align || packed || cacheline; }
+    };
+
+    // A field of an object
+    // For example :
+    // num x
+    struct Field
+    {
+        Id type;
+        Id id;
+        LayoutAttributes attributes;
+    };
+
+    // Position of a field within the C struct (x86-64)
+    struct FieldOffset
+    {
+        int offset;
+        int size;
+        // Alignment of the aligned attribute (0 if none)
+        int declaredAlign;
+        // Padding before the field
+        int padding;
+    };
+
     // For example :
     // obj MyObj
     // ID : MyObj
+    // * The struct of an object with fields is generated (see Compiler::layoutCode)
+    // * A collection with the soa layout has one array per field of
+    //   its element (soaOf)
+    //   obj Particles soa Particle
     class TypeDecl
     {
     public:
@@ -25,11 +76,49 @@ namespace up
     public:
         void process(Compiler *compiler);
 
+        // Whether the C code of the type is generated
+        inline bool hasLayout() const
+        { return !fields.empty() || !soaOf.ids.empty(); }
+
+        // Returns the field named ID
+        // !!! Can return nullptr
+        const Field *getField(const std::string &ID) const;
+
+        // Alignment of the aligned attribute of the struct (0 if none)
+        int declaredAlign() const;
+
+        // Positions of the fields, size and alignment of the struct
+        std::vector<FieldOffset> offsets(int &size, int &align) const;
+
     public:
         ErrorInfo info;
         Id id;
+
+        std::vector<Field> fields;
+        // Type of the elements (empty if this is not a collection)
+        Id soaOf;
+        // * The arrays of a collection are aligned
+        LayoutAttributes attributes;
     };
 
+    // A type within the source
+    // For example :
+    // Array[int] : Array_int (instance of a generic type)
+    // num[16] : num, count : 16
+    struct TypeName
+    {
+        Id id;
+        // Number of values of a table (0 if this is not a table)
+        int count = 0;
+    };
+
+    // Whether a table can contain values of this type (int, num or bool)
+    bool isTableType(const Id &TYPE);
+
+    // Size in bytes of the C type (x86-64), this is also its alignment
+    // * Objects are pointers
+    int typeSize(const Id &TYPE);
+
     // Casts up type to c type in string
     // !!! May return empty string if the type
     // !!! is an auto type
@@ -43,15 +132,29 @@ namespace up
     // Declares a new type
     void newType(const Id &ID, Compiler *compiler);
 
+    // Removes all declared types and operators except builtins
+    // * Called before each compilation
+    void resetTypes();
+
     // Whether a type already exists
     bool typeExists(const Id &ID);
 
+    // Returns the declaration of a type with fields or a soa layout
+    // !!! Can return nullptr
+    const TypeDecl *layoutOf(const Id &TYPE);
+
+    // Types with fields or a soa layout (in order of declaration)
+    const std::vector<TypeDecl> &layouts();
+
     // Whether both types are compatible
     bool compatibleType(const Id &a, const Id &b);    
 
     // Adds an operator for a type
     void declareOperator(const Id &TYPE, const std::string &OP);
 
+    // Returns all operators declared for this type
+    std::vector<std::string> operatorsOf(const Id &TYPE);
+
     // Whether this type provides this operator (OP)
     bool operatorExists(const Id &TYPE, const std::string &OP);
 
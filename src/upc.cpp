@@ -0,0 +1,83 @@
+#include "upc.h"
+
+#include "compiler.h"
+
+using namespace std;
+
+namespace up
+{
+    Upc::Upc()
+        : compiler(new Compiler())
+    {
+        // Errors are only returned with diagnostics
+        compiler->errorStream = nullptr;
+    }
+
+    Upc::~Upc()
+    {
+        delete compiler;
+    }
+
+    void Upc::addSource(const string &PATH, const string &CODE)
+    {
+        compiler->fs.addFile(PATH, CODE);
+        compiler->invalidateModule(PATH);
+    }
+
+    void Upc::clearSources()
+    {
+        compiler->fs.clear();
+        compiler->clearModuleCache();
+    }
+
+    void Upc::setModuleCache(const bool ENABLED)
+    {
+        compiler->cacheModules = ENABLED;
+
+        if (!ENABLED)
+            compiler->clearModuleCache();
+    }
+
+    void Upc::setDiskAccess(const bool ENABLED)
+    {
+        compiler->fs.useDisk = ENABLED;
+    }
+
+    void Upc::setIncludeDir(const string &DIR)
+    {
+        // The cached modules may come from the previous folder
+        if (DIR != compiler->includeDir)
+            compiler->clearModuleCache();
+
+        compiler->includeDir = DIR;
+    }
+
+    int Upc::compile(const string &ENTRY)
+    {
+        return compiler->compile(ENTRY);
+    }
+
+    int Upc::check(const string &ENTRY)
+    {
+        compiler->checkOnly = true;
+        int ret = compiler->compile(ENTRY);
+        compiler->checkOnly = false;
+
+        return ret;
+    }
+
+    const string &Upc::output() const
+    {
+        return compiler->output();
+    }
+
+    const string &Upc::gccFlags() const
+    {
+        return compiler->gccFlags;
+    }
+
+    const vector<Diagnostic> &Upc::diagnostics() const
+    {
+        return compiler->diagnostics;
+    }
+} // namespace up
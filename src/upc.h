@@ -0,0 +1,74 @@
+#pragma once
+
+// libupc : The Up compiler as a library
+// This header is the only one to include to embed
+// the compiler, it doesn't depend on generated files
+// For example :
+// up::Upc upc;
+// upc.addSource("main.up", "use libc\n$a = 42\n");
+// if (upc.compile("main.up") == 0)
+//     std::cout << upc.output();
+
+#include <string>
+#include <vector>
+
+#include "diagnostic.h"
+
+namespace up
+{
+    class Compiler;
+
+    class Upc
+    {
+    public:
+        Upc();
+        ~Upc();
+
+        Upc(const Upc&) = delete;
+        Upc &operator=(const Upc&) = delete;
+
+    public:
+        // Adds or replaces an in memory source file
+        // * PATH is relative to the working directory
+        void addSource(const std::string &PATH, const std::string &CODE);
+
+        // Removes all in memory source files
+        void clearSources();
+
+        // Whether files which are not in memory can be read
+        // on the disk (enabled by default)
+        void setDiskAccess(const bool ENABLED);
+
+        // Whether imported modules are parsed once and reused
+        // by the next compilations (disabled by default)
+        // * Modules are reparsed when their source is added again
+        void setModuleCache(const bool ENABLED);
+
+        // Sets the folder of the standard modules (str, array...)
+        // of this compiler, other instances keep their folder
+        // * Must end with a slash
+        void setIncludeDir(const std::string &DIR);
+
+        // Compiles the Up file located at ENTRY to C
+        // Returns 0 if no error
+        int compile(const std::string &ENTRY);
+
+        // Checks the Up file located at ENTRY without generating C
+        // Returns 0 if no error
+        int check(const std::string &ENTRY);
+
+        // The C program of the last successful compilation
+        const std::string &output() const;
+
+        // The gcc flags required by this program (OpenMP and threads)
+        // For example :
+        // " -fopenmp -pthread"
+        const std::string &gccFlags() const;
+
+        // Errors of the last compilation
+        const std::vector<Diagnostic> &diagnostics() const;
+
+    private:
+        Compiler *compiler;
+    };
+} // namespace up
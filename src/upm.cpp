@@ -0,0 +1,451 @@
+#include "upm.h"
+
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace up
+{
+    // File header
+    static const char UPM_MAGIC[4] = { 'U', 'P', 'M', '\0' };
+    static const uint32_t UPM_VERSION = 8;
+
+    // Function flags
+    static const uint8_t UPM_METHOD = 1;
+    static const uint8_t UPM_DESTRUCTOR = 2;
+    static const uint8_t UPM_PURE = 4;
+    static const uint8_t UPM_CONST = 8;
+    // The purity of a cdef function is declared (emitted as attribute)
+    static const uint8_t UPM_DECLARED = 16;
+    // Features of the body (see Compiler::gccFlags)
+    static const uint8_t UPM_SIMD = 32;
+    static const uint8_t UPM_PAR = 64;
+    static const uint8_t UPM_SPAWN = 128;
+    // Flags of the returned object (second byte)
+    static const uint8_t UPM_BORROWS = 1;
+
+    // Serializes values in a buffer
+    class UpmWriter
+    {
+    public:
+        void u32(const uint32_t V)
+        {
+            for (int i = 0; i < 4; ++i)
+                data += (char) ((V >> (8 * i)) & 0xFF);
+        }
+
+        void u8(const uint8_t V)
+        { data += (char) V; }
+
+        void str(const string &S)
+        {
+            u32(S.size());
+            data += S;
+        }
+
+    public:
+        string data;
+    };
+
+    // Reads values of a mapped file
+    // * ok is false if the end is reached
+    class UpmReader
+    {
+    public:
+        UpmReader(const char *begin, const size_t SIZE)
+            : cursor(begin), end(begin + SIZE)
+        {}
+
+    public:
+        uint32_t u32()
+        {
+            if (end - cursor < 4)
+                return fail();
+
+            uint32_t v = 0;
+            for (int i = 0; i < 4; ++i)
+                v |= (uint32_t) (uint8_t) cursor[i] << (8 * i);
+
+            cursor += 4;
+
+            return v;
+        }
+
+        uint8_t u8()
+        {
+            if (cursor == end)
+                return fail();
+
+            return (uint8_t) *cursor++;
+        }
+
+        string str()
+        {
+            const uint32_t SIZE = u32();
+
+            if (!ok || (size_t) (end - cursor) < SIZE)
+            {
+                fail();
+                return "";
+            }
+
+            string s(cursor, SIZE);
+            cursor += SIZE;
+
+            return s;
+        }
+
+        // Reads a dotted id
+        Id id()
+        {
+            const string S = str();
+            vector<string> ids;
+
+            size_t begin = 0;
+            for (size_t i = 0; i <= S.size(); ++i)
+                if (i == S.size() || S[i] == '.')
+                {
+                    ids.push_back(S.substr(begin, i - begin));
+                    begin = i + 1;
+                }
+
+            return Id(ids);
+        }
+
+    private:
+        uint32_t fail()
+        {
+            ok = false;
+            cursor = end;
+
+            return 0;
+        }
+
+    public:
+        bool ok = true;
+
+    private:
+        const char *cursor;
+        const char *end;
+    };
+
+    // Layout attributes of a type or a field
+    static void writeAttributes(UpmWriter &w, const LayoutAttributes &ATTRIBUTES)
+    {
+        w.u32(ATTRIBUTES.align);
+        w.u8(ATTRIBUTES.packed);
+        w.u8(ATTRIBUTES.cacheline);
+    }
+
+    static LayoutAttributes readAttributes(UpmReader &r)
+    {
+        LayoutAttributes attributes;
+        attributes.align = r.u32();
+        attributes.packed = r.u8();
+        attributes.cacheline = r.u8();
+
+        return attributes;
+    }
+
+    string upmPath(const string &SOURCE)
+    {
+        if (SOURCE.size() > 3 && SOURCE.substr(SOURCE.size() - 3) == ".up")
+            return SOURCE + "m";
+
+        return SOURCE + ".upm";
+    }
+
+    bool upmUpToDate(const string &UPM, const string &SOURCE)
+    {
+        struct stat upmStat, sourceStat;
+
+        if (stat(UPM.c_str(), &upmStat) != 0)
+            return false;
+
+        // Only the precompiled module is distributed
+        if (stat(SOURCE.c_str(), &sourceStat) != 0)
+            return true;
+
+        return upmStat.st_mtime >= sourceStat.st_mtime;
+    }
+
+    bool writeUpm(const string &PATH, const ModuleUnit &UNIT)
+    {
+        UpmWriter w;
+
+        w.data.append(UPM_MAGIC, 4);
+        w.u32(UPM_VERSION);
+
+        // Imports
+        w.u32(UNIT.imports.size());
+        for (auto &[mod, _] : UNIT.imports)
+        {
+            w.str(mod.id.toUp());
+            w.u8(mod.up);
+        }
+
+        // Types
+        w.u32(UNIT.types.size());
+        for (auto &type : UNIT.types)
+        {
+            w.str(type.id.toUp());
+
+            // Layout (fields and element of a soa collection)
+            w.u32(type.fields.size());
+            for (auto &f : type.fields)
+            {
+                w.str(f.type.toUp());
+                w.str(f.id.toUp());
+                writeAttributes(w, f.attributes);
+            }
+
+            w.str(type.soaOf.ids.empty() ? "" : type.soaOf.toUp());
+            writeAttributes(w, type.attributes);
+        }
+
+        // Operators
+        w.u32(UNIT.operators.size());
+        for (auto &[type, op] : UNIT.operators)
+        {
+            w.str(type.toUp());
+            w.str(op);
+        }
+
+        // Function signatures
+        // * Up functions are declared like cdef functions
+        string upCode = UNIT.upCode;
+        w.u32(UNIT.functions.size());
+        for (auto f : UNIT.functions)
+        {
+            w.str(f->type.toUp());
+            w.str(f->id.toUp());
+            w.u8((f->isMethod ? UPM_METHOD : 0) | (f->isDestructor ? UPM_DESTRUCTOR : 0) |
+                (f->purity == Purity::Pure ? UPM_PURE : 0) | (f->purity == Purity::Const ? UPM_CONST : 0) |
+                (f->isCDef && f->modifiers.purity != Purity::Impure ? UPM_DECLARED : 0) |
+                (f->usesSimd ? UPM_SIMD : 0) | (f->usesPar ? UPM_PAR : 0) | (f->usesSpawn ? UPM_SPAWN : 0));
+            w.u8(f->returnsBorrowed() ? UPM_BORROWS : 0);
+
+            w.u32(f->args.size());
+            for (auto arg : f->args)
+            {
+                w.str(arg->type.toUp());
+                w.str(arg->id.toUp());
+            }
+
+            if (!f->isCDef)
+                upCode += f->toString() + "\n";
+        }
+
+        // Constants (computed values)
+        w.u32(UNIT.constants.size());
+        for (auto c : UNIT.constants)
+        {
+            w.str(c->variable.type.toUp());
+            w.str(c->variable.id.toUp());
+            w.u32(c->variable.count);
+
+            w.u32(c->values.size());
+            for (auto &v : c->values)
+                w.str(v);
+        }
+
+        // Generic types (source of the templates)
+        w.u32(UNIT.generics.size());
+        for (auto &g : UNIT.generics)
+        {
+            w.str(g.id.toUp());
+            w.u32(g.info.line);
+
+            w.u32(g.params.size());
+            for (size_t j = 0; j < g.params.size(); ++j)
+            {
+                w.str(g.params[j]);
+                w.str(g.defaults[j]);
+            }
+
+            w.str(g.text);
+        }
+
+        // Instances used by the module
+        w.u32(UNIT.instances.size());
+        for (auto &[id, args, _] : UNIT.instances)
+        {
+            w.str(id.toUp());
+
+            w.u32(args.size());
+            for (auto &arg : args)
+                w.str(arg.toUp());
+        }
+
+        // C code
+        w.str(UNIT.cCode);
+        w.str(upCode);
+
+        ofstream out(PATH, ios::binary);
+        if (!out.is_open())
+            return false;
+
+        out.write(w.data.data(), w.data.size());
+
+        return out.good();
+    }
+
+    ModuleUnit *readUpm(const string &PATH, const Module &MOD)
+    {
+        int fd = open(PATH.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < 8)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (map == MAP_FAILED)
+            return nullptr;
+
+        // Skip the magic
+        UpmReader r((const char*) map + 4, st.st_size - 4);
+        ModuleUnit *unit = nullptr;
+
+        // Check header
+        if (memcmp(map, UPM_MAGIC, 4) == 0 && r.u32() == UPM_VERSION)
+            unit = new ModuleUnit();
+
+        if (unit)
+        {
+            const ErrorInfo INFO(MOD, 0, 0);
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                Id id = r.id();
+                bool up = r.u8();
+
+                unit->imports.push_back({ Module(id, up, MOD.folder), INFO });
+            }
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                TypeDecl type(INFO, r.id());
+
+                for (uint32_t j = r.u32(); r.ok && j > 0; --j)
+                {
+                    Field f;
+                    f.type = r.id();
+                    f.id = r.id();
+                    f.attributes = readAttributes(r);
+                    type.fields.push_back(f);
+                }
+
+                const string SOA_OF = r.str();
+                if (!SOA_OF.empty())
+                    type.soaOf = Id(SOA_OF);
+                type.attributes = readAttributes(r);
+
+                unit->types.push_back(type);
+            }
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                Id type = r.id();
+                unit->operators.push_back({ type, r.str() });
+            }
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                Id type = r.id();
+                Id id = r.id();
+                uint8_t flags = r.u8();
+                uint8_t returnFlags = r.u8();
+
+                vector<Argument*> args;
+                for (uint32_t j = r.u32(); r.ok && j > 0; --j)
+                {
+                    Id argType = r.id();
+                    args.push_back(new Argument(INFO, argType, r.id()));
+                }
+
+                Function *f = new Function(INFO, type, id, args, true);
+                f->isMethod = flags & UPM_METHOD;
+                f->isDestructor = flags & UPM_DESTRUCTOR;
+                f->usesSimd = flags & UPM_SIMD;
+                f->usesPar = flags & UPM_PAR;
+                f->usesSpawn = flags & UPM_SPAWN;
+                f->borrows = returnFlags & UPM_BORROWS;
+                f->purity = flags & UPM_CONST ? Purity::Const :
+                    flags & UPM_PURE ? Purity::Pure : Purity::Impure;
+                // The inferred purity of up functions is not emitted
+                if (flags & UPM_DECLARED)
+                    f->modifiers.purity = f->purity;
+                // The signature has been checked when the module has been precompiled
+                f->processed = true;
+
+                unit->functions.push_back(f);
+            }
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                Id type = r.id();
+                Id id = r.id();
+                int count = r.u32();
+
+                Constant *c = new Constant(INFO, type, id, nullptr, count);
+                for (uint32_t j = r.u32(); r.ok && j > 0; --j)
+                    c->values.push_back(r.str());
+
+                unit->constants.push_back(c);
+            }
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                GenericDecl g;
+                g.id = r.id();
+                g.info = ErrorInfo(MOD, r.u32(), 1);
+
+                for (uint32_t j = r.u32(); r.ok && j > 0; --j)
+                {
+                    g.params.push_back(r.str());
+                    g.defaults.push_back(r.str());
+                }
+
+                g.text = r.str();
+                unit->generics.push_back(g);
+            }
+
+            for (uint32_t i = r.u32(); r.ok && i > 0; --i)
+            {
+                Id id = r.id();
+
+                vector<Id> args;
+                for (uint32_t j = r.u32(); r.ok && j > 0; --j)
+                    args.push_back(r.id());
+
+                unit->instances.push_back({ id, args, INFO });
+            }
+
+            unit->cCode = r.str();
+            unit->upCode = r.str();
+
+            if (!r.ok)
+            {
+                delete unit;
+                unit = nullptr;
+            }
+        }
+
+        munmap(map, st.st_size);
+
+        return unit;
+    }
+} // namespace up
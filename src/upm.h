@@ -0,0 +1,32 @@
+#pragma once
+
+// Precompiled modules (.upm)
+// A .upm file contains the declarations of an up module :
+// imports, types, operators, function signatures and C code
+// (C sections and generated up functions)
+// * Integers are little endian u32, strings are prefixed by their size
+
+#include <string>
+
+#include "module_unit.h"
+
+namespace up
+{
+    // Returns the path of the precompiled module of SOURCE
+    // For example :
+    // dir/array.up -> dir/array.upm
+    std::string upmPath(const std::string &SOURCE);
+
+    // Whether the precompiled module UPM can be used instead of SOURCE
+    // * SOURCE can be missing
+    bool upmUpToDate(const std::string &UPM, const std::string &SOURCE);
+
+    // Writes a processed unit to PATH
+    // Returns whether there is no error
+    bool writeUpm(const std::string &PATH, const ModuleUnit &UNIT);
+
+    // Loads the unit of the precompiled module at PATH (with mmap)
+    // * MOD is the module which is loaded
+    // Returns nullptr if the file can't be read or is invalid
+    ModuleUnit *readUpm(const std::string &PATH, const Module &MOD);
+} // namespace up
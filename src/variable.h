@@ -3,11 +3,14 @@
 // Variable class (semantics)
 
 #include <string>
+#include <vector>
 
 #include "id.h"
 
 namespace up
 {
+    class Function;
+
     class Variable
     {
     public:
@@ -16,8 +19,45 @@ namespace up
             : id(ID), type(TYPE)
         {}
 
+    public:
+        // Whether the object is stored on the stack
+        // (it is constructed in place and doesn't escape)
+        inline bool onStack() const
+        { return inPlace && !escapes; }
+
     public:
         Id id;
         Id type;
+
+        // Whether the variable may be used outside of its block
+        // (returned, passed to a function, copied, used in C...)
+        // * Method calls on the variable don't make it escape
+        bool escapes = false;
+
+        // Whether the object can be constructed in place (T.init and T.fini)
+        bool inPlace = false;
+
+        // Number of elements of a table (0 if this is not a table)
+        int count = 0;
+
+        // Whether the variable can't be modified
+        bool isConst = false;
+
+        // Whether the object is not accessed through another variable
+        // (noalias argument)
+        bool noalias = false;
+
+        // Whether the variable is initialized by a constructor
+        // (a new object, distinct from the others if it doesn't escape)
+        bool constructed = false;
+
+        // Functions whose results are assigned to the variable, the variable
+        // owns its object (destroyed at the end of its block) if none of them
+        // returns a borrowed object (see Function::returnsBorrowed)
+        std::vector<Function*> creators;
+
+        // Whether an object of another variable may be assigned to the
+        // variable (copy, field, declaration without value...)
+        bool borrows = false;
     }; 
 } // namespace up
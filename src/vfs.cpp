@@ -0,0 +1,89 @@
+#include "vfs.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace up
+{
+    string VirtualFS::normalize(const string &PATH)
+    {
+        string s;
+        size_t i = 0;
+
+        while (i < PATH.size())
+        {
+            size_t slash = PATH.find('/', i);
+            if (slash == string::npos)
+                slash = PATH.size();
+
+            const string PART = PATH.substr(i, slash - i);
+
+            // Ignore empty and current folder parts (except the root)
+            if (PART == "." || (PART.empty() && i != 0))
+            {
+                i = slash + 1;
+                continue;
+            }
+
+            if (!s.empty() && s.back() != '/')
+                s += '/';
+            s += PART.empty() ? "/" : PART;
+
+            i = slash + 1;
+        }
+
+        return s.empty() ? "." : s;
+    }
+
+    void VirtualFS::addFile(const string &PATH, const string &CONTENT)
+    {
+        files[normalize(PATH)] = CONTENT;
+    }
+
+    void VirtualFS::removeFile(const string &PATH)
+    {
+        files.erase(normalize(PATH));
+    }
+
+    void VirtualFS::clear()
+    {
+        files.clear();
+    }
+
+    bool VirtualFS::read(const string &PATH, string &content) const
+    {
+        // In memory
+        auto i = files.find(normalize(PATH));
+        if (i != files.end())
+        {
+            content = i->second;
+            return true;
+        }
+
+        if (!useDisk)
+            return false;
+
+        // On the disk
+        ifstream f(PATH);
+        if (!f.is_open())
+            return false;
+
+        stringstream s;
+        s << f.rdbuf();
+        content = s.str();
+
+        return true;
+    }
+
+    bool VirtualFS::exists(const string &PATH) const
+    {
+        return inMemory(PATH) || (useDisk && ifstream(PATH).good());
+    }
+
+    bool VirtualFS::inMemory(const string &PATH) const
+    {
+        return files.find(normalize(PATH)) != files.end();
+    }
+} // namespace up
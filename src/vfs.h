@@ -0,0 +1,51 @@
+#pragma once
+
+// Virtual file system used to read up sources
+
+#include <string>
+#include <map>
+
+namespace up
+{
+    // Gathers in memory files, files which are not
+    // in memory are read from the disk (if useDisk)
+    // For example :
+    // fs.addFile("main.up", "use libc\n");
+    class VirtualFS
+    {
+    public:
+        // Removes ./ and duplicated slashes
+        // For example :
+        // ./dir//./main.up -> dir/main.up
+        static std::string normalize(const std::string &PATH);
+
+    public:
+        // Adds or replaces an in memory file
+        void addFile(const std::string &PATH, const std::string &CONTENT);
+
+        // Removes an in memory file
+        void removeFile(const std::string &PATH);
+
+        // Removes all in memory files
+        void clear();
+
+        // Reads the file located at PATH in content
+        // * In memory files are searched first
+        // Returns whether the file has been found
+        bool read(const std::string &PATH, std::string &content) const;
+
+        // Whether the file can be read
+        bool exists(const std::string &PATH) const;
+
+        // Whether the file is an in memory file
+        bool inMemory(const std::string &PATH) const;
+
+    public:
+        // Whether files not found in memory are read from the disk
+        bool useDisk = true;
+
+    private:
+        // Normalized path -> content
+        std::map<std::string, std::string> files;
+    };
+} // namespace up